@@ -0,0 +1,88 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Bench.hpp                                                                   *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+
+#include <algorithm>
+#include <QElapsedTimer>
+#include <QList>
+
+
+/**
+ * namespace Bench
+ *
+ * Timing shared by the benchmarks in bench/. Each measurement is run a few times and reported as
+ * it's fastest and median run, so one slow run (cold caches, another process) doesn't skew it.
+ */
+namespace Bench {
+	static const int NUM_OF_RUNS = 5;
+
+	/**
+	 * Nanoseconds taken by the fastest and the median run.
+	 */
+	struct Result {
+		qint64 best;
+		qint64 median;
+	};
+
+
+	/**
+	 * Returns fastest and median of time_list, which is sorted.
+	 */
+	static inline Result summarize(QList<qint64> &time_list) {
+		std::sort(time_list.begin(), time_list.end());
+		return Result{time_list.first(), time_list[time_list.size() / 2]};
+	}
+
+
+	/**
+	 * Calls f num_of_runs times, timing each call.
+	 */
+	template<typename Function>
+	static Result run(Function f, const int num_of_runs = NUM_OF_RUNS) {
+		QList<qint64> time_list;
+
+		for(int i = 0; i < num_of_runs; i++) {
+			QElapsedTimer timer;
+			timer.start();
+			f();
+			time_list << timer.nsecsElapsed();
+		}
+
+		return summarize(time_list);
+	}
+
+
+	/**
+	 * Calls f num_of_runs times, f times itself and returns nanoseconds taken, for runs with setup
+	 * or cleanup that shouldn't be counted.
+	 */
+	template<typename Function>
+	static Result runTimed(Function f, const int num_of_runs = NUM_OF_RUNS) {
+		QList<qint64> time_list;
+		for(int i = 0; i < num_of_runs; i++) time_list << f();
+
+		return summarize(time_list);
+	}
+}
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+/**
+ * Measures the paths that go over every comic in library: Library::append() of a whole library's
+ * worth of comics (what importing and loading do), and LibraryView rebuilding it's rows after
+ * library changed (LibraryModel::buildRows(), through LibraryView::refreshModel()). Each comic used
+ * to be copied, and connected to it's ComicInfo, several times on the way, now comics are copied
+ * once into library and walked by reference.
+ *
+ * Runs the real app offscreen, with HOME pointed at a temp dir whose config has an empty comic dir,
+ * so there's nothing to load or scan.
+ *
+ * Usage: bench_ComicFile comic_path [num_of_comics]
+ * Library is num_of_comics (default 10000) copies of the comic at comic_path, spread over series of
+ * 10 comics and publishers of 1000.
+ */
+#include <QApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
+#include "bench/Bench.hpp"
+#include "src/ComicFile.hpp"
+#include "src/Config.hpp"
+#include "src/Library.hpp"
+#include "src/LibraryView.hpp"
+#include "src/MainWindow.hpp"
+
+
+static void print(const char *name, const int num_of_comics, const Bench::Result &result) {
+	qDebug().nospace() << name << ": best " << result.best / num_of_comics / 1000.0 <<
+		" us/comic, median " << result.median / num_of_comics / 1000.0 << " us/comic";
+}
+
+
+int main(int argc, char **argv) {
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QApplication app(argc, argv);
+	if(argc < 2) {
+		qDebug() << "Usage: bench_ComicFile comic_path [num_of_comics]";
+		return 1;
+	}
+
+	const QString path		=	app.arguments().at(1);
+	const int num_of_comics	=	(argc > 2) ? app.arguments().at(2).toInt() : 10000;
+	if(!QFile::exists(path) || num_of_comics <= 0) {
+		qDebug() << "Failed to open" << path;
+		return 1;
+	}
+
+	// Config with an empty comic dir, so first run dialog is skipped and library starts out empty
+	QTemporaryDir home_dir;
+	qputenv("HOME", home_dir.path().toLocal8Bit());
+	Config::init();
+	config->setComicDir(home_dir.path() + "/Comics");
+	config->setComicEnabled(true);
+	config->setAllEnabled(true);
+	config->save();
+	Config::destroy();
+
+	if(!MainWindow::init()) return 1;
+
+	ComicFile comic(path, ComicFile::generateMd5Hash(path), FileStat::fromPath(path));
+	if(comic.isNull()) {
+		qDebug() << "Failed to open" << path;
+		return 1;
+	}
+
+	// Copies aren't connected, so these edits stay in the list
+	QList<ComicFile> comic_list;
+	for(int i = 0; i < num_of_comics; i++) {
+		comic_list << comic;
+		comic_list.last().info.setPublisher(QString("Publisher %1").arg(i / 1000));
+		comic_list.last().info.setSeries(QString("Series %1").arg(i / 10));
+	}
+
+	// Appended and removed in a transaction, so library is only saved once per run
+	print("Library::append()", num_of_comics, Bench::runTimed([&] {
+		library->beginTransaction();
+		QElapsedTimer timer;
+		timer.start();
+		library->append(comic_list);
+		qint64 elapsed = timer.nsecsElapsed();
+		library->removePaths({path});
+		library->commit();
+		return elapsed;
+	}));
+
+	library->append(comic_list);
+
+	print("LibraryView::refreshModel()", num_of_comics, Bench::run([] {
+		library_view->refreshModel();
+	}));
+
+	Library::destroy();
+	Config::destroy();
+	MainWindow::destroy();
+
+	return 0;
+}
\ No newline at end of file
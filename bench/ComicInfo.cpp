@@ -0,0 +1,162 @@
+/**
+ * Compares parsing ComicInfo.xml the way ComicFile::loadComicInfo() did before tag lookup was
+ * hashed (whole buffer converted to a QString, each element name compared against every tag) with
+ * how it parses now (raw buffer, ComicInfo::indexOf() on the QStringRef name).
+ *
+ * Usage: bench_ComicInfo [ComicInfo.xml...]
+ * Without arguments a typical ComicInfo.xml with 24 pages is generated.
+ */
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "bench/Bench.hpp"
+#include "src/ComicInfo.hpp"
+#include "src/Page.hpp"
+
+
+static const int NUM_OF_PARSES = 20000; // Spread over all samples
+
+
+static QByteArray makeSample() {
+	QByteArray xml_buf;
+	QXmlStreamWriter writer(&xml_buf);
+	writer.setAutoFormatting(true);
+	writer.writeStartDocument("1.0");
+	writer.writeStartElement("ComicInfo");
+	writer.writeTextElement("Title", "The Sample Issue");
+	writer.writeTextElement("Series", "Sample Series");
+	writer.writeTextElement("Number", "12");
+	writer.writeTextElement("Count", "24");
+	writer.writeTextElement("Volume", "2");
+	writer.writeTextElement("Summary", QString("A summary that goes on for a while. ").repeated(8));
+	writer.writeTextElement("Year", "2014");
+	writer.writeTextElement("Month", "6");
+	writer.writeTextElement("Writer", "Some Writer");
+	writer.writeTextElement("Penciller", "Some Penciller");
+	writer.writeTextElement("Inker", "Some Inker");
+	writer.writeTextElement("Colorist", "Some Colorist");
+	writer.writeTextElement("Letterer", "Some Letterer");
+	writer.writeTextElement("CoverArtist", "Some Cover Artist");
+	writer.writeTextElement("Publisher", "Some Publisher");
+	writer.writeTextElement("Genre", "Superhero, Action");
+	writer.writeTextElement("PageCount", "24");
+	writer.writeTextElement("LanguageISO", "en");
+	writer.writeTextElement("Manga", "No");
+
+	writer.writeStartElement("Pages");
+	for(int i = 0; i < 24; i++) {
+		writer.writeEmptyElement("Page");
+		writer.writeAttribute("Image", QString::number(i));
+		if(i == 0) writer.writeAttribute("Type", "FrontCover");
+		writer.writeAttribute("ImageSize", QString::number(400000 + i));
+		writer.writeAttribute("ImageWidth", "1988");
+		writer.writeAttribute("ImageHeight", "3056");
+	}
+	writer.writeEndElement(); // </Pages>
+
+	writer.writeEndElement(); // </ComicInfo>
+	writer.writeEndDocument();
+
+	return xml_buf;
+}
+
+
+static void readPages(QXmlStreamReader &reader, PageList &page_list) {
+	reader.readNextStartElement();
+	while(reader.name() == "Page") {
+		if(!reader.isEndElement()) page_list << Page::fromXml(reader.attributes());
+		reader.readNextStartElement();
+	}
+}
+
+
+/**
+ * Tag names were QString members of each tag before, so they're built once here to match.
+ */
+static int parseOld(const QByteArray &xml_buf) {
+	static QStringList name_list;
+	if(name_list.isEmpty()) {
+		for(int i = 0; i < ComicInfo::NUM_OF_TAGS; i++) name_list << ComicInfo::getName(i);
+	}
+
+	QString value_list[ComicInfo::NUM_OF_TAGS];
+	PageList page_list;
+	QXmlStreamReader reader(QString::fromUtf8(xml_buf));
+
+	while(!reader.atEnd()) {
+		reader.readNextStartElement();
+		if(reader.isEndElement() || reader.name() == "") continue;
+
+		const QString name = reader.name().toString();
+		int tag_index = -1;
+		for(int i = 0; i < ComicInfo::NUM_OF_TAGS; i++) {
+			if(name_list[i] == name) {
+				tag_index = i;
+				break;
+			}
+		}
+
+		if(tag_index != -1) value_list[tag_index] = reader.readElementText();
+		else if(name == "Pages") readPages(reader, page_list);
+	}
+
+	return page_list.size();
+}
+
+
+static int parseNew(const QByteArray &xml_buf) {
+	QString value_list[ComicInfo::NUM_OF_TAGS];
+	PageList page_list;
+	QXmlStreamReader reader(xml_buf);
+
+	while(!reader.atEnd()) {
+		reader.readNextStartElement();
+		if(reader.isEndElement() || reader.name() == "") continue;
+
+		int tag_index = ComicInfo::indexOf(reader.name());
+		if(tag_index != -1) value_list[tag_index] = reader.readElementText();
+		else if(reader.name() == "Pages") readPages(reader, page_list);
+	}
+
+	return page_list.size();
+}
+
+
+/**
+ * Parses every sample with f until NUM_OF_PARSES is reached, prints time per parse.
+ */
+template<typename Function>
+static void run(const char *name, const QList<QByteArray> &sample_list, Function f) {
+	int num_of_pages = 0;
+	Bench::Result result = Bench::run([&] {
+		for(int i = 0; i < NUM_OF_PARSES; i++) {
+			num_of_pages += f(sample_list[i % sample_list.size()]);
+		}
+	});
+
+	qDebug().nospace() << name << ": best " << result.best / NUM_OF_PARSES / 1000.0 <<
+		" us/parse, median " << result.median / NUM_OF_PARSES / 1000.0 << " us/parse (" <<
+		num_of_pages / Bench::NUM_OF_RUNS << " pages)";
+}
+
+
+int main(int argc, char **argv) {
+	QCoreApplication app(argc, argv);
+	QList<QByteArray> sample_list;
+
+	for(const QString &path : app.arguments().mid(1)) {
+		QFile file(path);
+		if(file.open(QIODevice::ReadOnly)) sample_list << file.readAll();
+		else qDebug() << "Failed to open" << path;
+	}
+
+	if(sample_list.isEmpty()) sample_list << makeSample();
+
+	run("QString + linear lookup", sample_list, parseOld);
+	run("QByteArray + hashed lookup", sample_list, parseNew);
+
+	return 0;
+}
\ No newline at end of file
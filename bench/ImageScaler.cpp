@@ -0,0 +1,131 @@
+/**
+ * Compares ImageScaler with QImage::scaled() (fast and smooth) for speed, and for aliasing on fine
+ * patterns that should come out flat gray: 1px stripes, a 1px checkerboard, and dense diagonal
+ * lines. Aliasing is the standard deviation of output luminance, lower is better.
+ *
+ * Usage: bench_ImageScaler [page_image...]
+ * Pages are scaled to fit 512, 256 and 128 px. Without arguments a 1988x3056 page is generated.
+ */
+#include <algorithm>
+#include <cmath>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QImage>
+
+#include "bench/Bench.hpp"
+#include "src/ImageScaler.hpp"
+
+
+static const int NUM_OF_SCALES	=	20; // Spread over all pages
+static const int NUM_OF_RUNS	=	3; // Fewer than usual, full size pages are slow
+
+
+enum Pattern {
+	STRIPES,
+	CHECKERBOARD,
+	DIAGONALS
+};
+
+
+static QImage makePattern(const Pattern pattern) {
+	QImage image(1988, 3056, QImage::Format_RGB32);
+	image.fill(Qt::white);
+
+	for(int y = 0; y < image.height(); y++) {
+		QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+		for(int x = 0; x < image.width(); x++) {
+			bool black = false;
+			switch(pattern) {
+				case STRIPES:		black = (x % 2 == 0);			break;
+				case CHECKERBOARD:	black = ((x + y) % 2 == 0);		break;
+				case DIAGONALS:		black = ((x + 2 * y) % 4 < 2);	break;
+			}
+
+			if(black) line[x] = qRgb(0, 0, 0);
+		}
+	}
+
+	return image;
+}
+
+
+/**
+ * Standard deviation of luminance over image.
+ */
+static double deviation(const QImage &image) {
+	double sum = 0, sum_of_squares = 0;
+	for(int y = 0; y < image.height(); y++) {
+		for(int x = 0; x < image.width(); x++) {
+			double gray = qGray(image.pixel(x, y));
+			sum += gray;
+			sum_of_squares += gray * gray;
+		}
+	}
+
+	double n = double(image.width()) * image.height();
+	return std::sqrt(std::max(0.0, sum_of_squares / n - (sum / n) * (sum / n)));
+}
+
+
+/**
+ * Scales pages with f until NUM_OF_SCALES is reached, prints milliseconds per image.
+ */
+template<typename Function>
+static void run(const QString &name, const QList<QImage> &page_list, Function f) {
+	Bench::Result result = Bench::run([&] {
+		for(int i = 0; i < NUM_OF_SCALES; i++) f(page_list[i % page_list.size()]);
+	}, NUM_OF_RUNS);
+
+	qDebug().nospace() << qPrintable(name) << ": best " << result.best / NUM_OF_SCALES / 1e6 <<
+		" ms/image, median " << result.median / NUM_OF_SCALES / 1e6 << " ms/image";
+}
+
+
+int main(int argc, char **argv) {
+	QCoreApplication app(argc, argv);
+	QList<QImage> page_list;
+
+	for(const QString &path : app.arguments().mid(1)) {
+		QImage image(path);
+		if(!image.isNull()) page_list << image.convertToFormat(QImage::Format_RGB32);
+		else qDebug() << "Failed to open" << path;
+	}
+
+	if(page_list.isEmpty()) page_list << makePattern(DIAGONALS);
+
+	QList<QImage> gray_list;
+	for(const QImage &page : page_list) {
+		gray_list << page.convertToFormat(QImage::Format_Grayscale8);
+	}
+
+	qDebug() << "Speed:";
+	for(int size : {512, 256, 128}) {
+		for(const QImage::Format format : {QImage::Format_RGB32, QImage::Format_Grayscale8}) {
+			const QList<QImage> &list = (format == QImage::Format_RGB32) ? page_list : gray_list;
+			const QString suffix = QString(" %1px %2").arg(size)
+				.arg((format == QImage::Format_RGB32) ? "RGB32" : "Grayscale8");
+
+			run("Fast" + suffix, list, [size](const QImage &image) {
+				return image.scaled(size, size, Qt::KeepAspectRatio);
+			});
+			run("Smooth" + suffix, list, [size](const QImage &image) {
+				return image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+			});
+			run("ImageScaler" + suffix, list, [size](const QImage &image) {
+				return ImageScaler::scaled(image, size, size);
+			});
+		}
+	}
+
+	qDebug() << "Aliasing at 256px (luminance std dev, lower is better):";
+	const char *pattern_names[] = {"stripes", "checkerboard", "diagonals"};
+	for(const Pattern pattern : {STRIPES, CHECKERBOARD, DIAGONALS}) {
+		const QImage image = makePattern(pattern);
+		qDebug().nospace() << pattern_names[pattern] << ": fast " <<
+			deviation(image.scaled(256, 256, Qt::KeepAspectRatio)) << ", smooth " <<
+			deviation(image.scaled(256, 256, Qt::KeepAspectRatio, Qt::SmoothTransformation)) <<
+			", ImageScaler " << deviation(ImageScaler::scaled(image, 256, 256));
+	}
+
+	return 0;
+}
\ No newline at end of file
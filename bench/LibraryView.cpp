@@ -0,0 +1,187 @@
+/**
+ * Compares QListView in IconMode set up the way LibraryView was before (every item laid out at
+ * once, and sized by asking the model) with how it's set up now (uniform grid, batched layout), on
+ * a synthetic scope of NUM_OF_ITEMS titles. Measures time to lay out, model data() calls, and frame
+ * time while scrolling a page at a time. Also compares finding visible rows with LibraryView's
+ * binary search against checking every item.
+ *
+ * Usage: bench_LibraryView [num_of_items]
+ * Runs on the offscreen platform unless QT_QPA_PLATFORM is set.
+ */
+#include <algorithm>
+#include <QAbstractListModel>
+#include <QApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QListView>
+#include <QPixmap>
+#include <QScrollBar>
+
+#include "bench/Bench.hpp"
+
+
+static const int NUM_OF_ITEMS		=	100000;
+static const int NUM_OF_FRAMES		=	200;
+
+// Same as LibraryView at it's largest zoom
+static const int ICON_SIZE			=	256;
+static const int SPACING			=	15;
+static const int NUM_OF_TEXT_LINES	=	3;
+static const int BATCH_SIZE			=	500;
+
+
+/**
+ * Titles with a placeholder icon, like LibraryModel before thumbnails have loaded, counting calls
+ * to data().
+ */
+class BenchModel : public QAbstractListModel {
+	public:
+		mutable int num_of_calls = 0;
+
+		BenchModel(const int _num_of_items) : num_of_items(_num_of_items) {
+			placeholder = QPixmap(ICON_SIZE * 2 / 3, ICON_SIZE);
+			placeholder.fill(Qt::gray);
+		}
+
+		int rowCount(const QModelIndex &parent = QModelIndex()) const {
+			return parent.isValid() ? 0 : num_of_items;
+		}
+
+		QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const {
+			num_of_calls++;
+			switch(role) {
+				case Qt::DisplayRole:
+					return QString("Series %1\nVol. %2 No. %3\nTitle of issue %4")
+						.arg(index.row() / 100).arg(index.row() / 10 % 10).arg(index.row() % 10)
+						.arg(index.row());
+
+				case Qt::DecorationRole:
+					return placeholder;
+
+				default:
+					return QVariant();
+			}
+		}
+
+	private:
+		int num_of_items;
+		QPixmap placeholder;
+};
+
+
+/**
+ * Same as LibraryView::rowsInRect().
+ */
+static QPair<int, int> rowsInRect(const QListView &view, const QRect &rect) {
+	const QAbstractItemModel *model = view.model();
+	int low = 0, high = model->rowCount();
+	while(low < high) {
+		int mid = (low + high) / 2;
+		QRect item_rect = view.visualRect(model->index(mid, 0));
+		if(!item_rect.isEmpty() && item_rect.bottom() < rect.top()) low = mid + 1;
+		else high = mid;
+	}
+
+	int first = low;
+	high = model->rowCount();
+	while(low < high) {
+		int mid = (low + high) / 2;
+		QRect item_rect = view.visualRect(model->index(mid, 0));
+		if(!item_rect.isEmpty() && item_rect.top() <= rect.bottom()) low = mid + 1;
+		else high = mid;
+	}
+
+	return QPair<int, int>(first, low - 1);
+}
+
+
+static QPair<int, int> rowsInRectLinear(const QListView &view, const QRect &rect) {
+	const QAbstractItemModel *model = view.model();
+	int first = -1, last = -2;
+	for(int row = 0; row < model->rowCount(); row++) {
+		if(view.visualRect(model->index(row, 0)).intersects(rect)) {
+			if(first == -1) first = row;
+			last = row;
+		}
+	}
+
+	return QPair<int, int>(first, last);
+}
+
+
+static void run(const char *name, const int num_of_items, const bool uniform) {
+	BenchModel model(num_of_items);
+	QListView view;
+	view.resize(1280, 800);
+	view.setViewMode(QListView::IconMode);
+	view.setIconSize(QSize(ICON_SIZE, ICON_SIZE));
+	view.setSpacing(SPACING);
+	view.setResizeMode(QListView::Adjust);
+
+	if(uniform) {
+		view.setGridSize(QSize(ICON_SIZE + SPACING * 2,
+			ICON_SIZE + SPACING + view.fontMetrics().lineSpacing() * NUM_OF_TEXT_LINES));
+		view.setUniformItemSizes(true);
+		view.setLayoutMode(QListView::Batched);
+		view.setBatchSize(BATCH_SIZE);
+	}
+
+	// Time until first screen is shown, then until every item is laid out
+	QElapsedTimer timer;
+	timer.start();
+	view.setModel(&model);
+	view.show();
+	view.viewport()->repaint();
+	QApplication::processEvents();
+	qint64 first_screen = timer.elapsed();
+
+	const QModelIndex last_index = model.index(num_of_items - 1, 0);
+	while(view.visualRect(last_index).isEmpty()) QApplication::processEvents();
+	qint64 layout = timer.elapsed();
+	int layout_calls = model.num_of_calls;
+
+	// Scroll a page at a time, painting every frame
+	QScrollBar *scroll_bar = view.verticalScrollBar();
+	const int scroll_range = qMax(1, scroll_bar->maximum());
+	QList<qint64> frame_list;
+	model.num_of_calls = 0;
+	for(int i = 0; i < NUM_OF_FRAMES; i++) {
+		timer.restart();
+		scroll_bar->setValue((scroll_bar->value() + scroll_bar->pageStep()) % scroll_range);
+		view.viewport()->repaint();
+		frame_list << timer.nsecsElapsed();
+	}
+	std::sort(frame_list.begin(), frame_list.end());
+
+	// Visible rows, as found when requesting thumbnails
+	const QRect viewport_rect = view.viewport()->rect();
+	QPair<int, int> rows, linear_rows;
+	Bench::Result binary_search = Bench::run([&] { rows = rowsInRect(view, viewport_rect); });
+	Bench::Result linear_search = Bench::run([&] {
+		linear_rows = rowsInRectLinear(view, viewport_rect);
+	});
+
+	qDebug().nospace() << name << ":";
+	qDebug().nospace() << "  first screen " << first_screen << " ms, all laid out " << layout <<
+		" ms, " << layout_calls << " data() calls";
+	qDebug().nospace() << "  scroll frame median " << frame_list[NUM_OF_FRAMES / 2] / 1e6 <<
+		" ms, 95th percentile " << frame_list[NUM_OF_FRAMES * 95 / 100] / 1e6 << " ms, " <<
+		model.num_of_calls / NUM_OF_FRAMES << " data() calls per frame";
+	qDebug().nospace() << "  visible rows " << rows.first << "-" << rows.second << " in " <<
+		binary_search.median / 1000.0 << " us, checking every item " << linear_rows.first << "-" <<
+		linear_rows.second << " in " << linear_search.median / 1000.0 << " us (median)";
+}
+
+
+int main(int argc, char **argv) {
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QApplication app(argc, argv);
+	int num_of_items = (argc > 1) ? app.arguments().at(1).toInt() : NUM_OF_ITEMS;
+	if(num_of_items <= 0) num_of_items = NUM_OF_ITEMS;
+
+	run("Before (sized by model, laid out at once)", num_of_items, false);
+	run("Uniform grid, batched", num_of_items, true);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+/**
+ * Compares making thumbnails from JPEG pages by decoding at full size and scaling (how covers and
+ * page previews were made before) with ComicFile::decodeImage(), which lets libjpeg decode at 1/2,
+ * 1/4 or 1/8 scale first.
+ *
+ * Usage: bench_ScaledDecode [page.jpg...]
+ * Without arguments a 1988x3056 page of line art is generated.
+ */
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+
+#include "bench/Bench.hpp"
+#include "src/ComicFile.hpp"
+
+
+static const int NUM_OF_THUMBS	=	50; // Spread over all pages
+static const int NUM_OF_RUNS	=	3; // Fewer than usual, full size pages are slow
+
+
+static QByteArray makePage() {
+	QImage image(1988, 3056, QImage::Format_RGB32);
+	image.fill(Qt::white);
+
+	QPainter painter(&image);
+	for(int i = 0; i < image.height(); i += 7) {
+		painter.setPen(QColor::fromHsv((i / 7) % 360, 200, 120));
+		painter.drawLine(0, i, image.width(), image.height() - i);
+	}
+	painter.end();
+
+	QByteArray data;
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::WriteOnly);
+	image.save(&buffer, "JPG", 90);
+
+	return data;
+}
+
+
+/**
+ * Makes NUM_OF_THUMBS thumbnails with f, prints thumbnails per second.
+ */
+template<typename Function>
+static void run(const QString &name, const QList<QByteArray> &page_list, Function f) {
+	Bench::Result result = Bench::run([&] {
+		for(int i = 0; i < NUM_OF_THUMBS; i++) {
+			if(f(page_list[i % page_list.size()]).isNull()) qDebug() << "Failed to decode page";
+		}
+	}, NUM_OF_RUNS);
+
+	qDebug().nospace() << qPrintable(name) << ": best " << NUM_OF_THUMBS * 1e9 / result.best <<
+		" thumbs/s, median " << NUM_OF_THUMBS * 1e9 / result.median << " thumbs/s";
+}
+
+
+int main(int argc, char **argv) {
+	QCoreApplication app(argc, argv);
+	QList<QByteArray> page_list;
+
+	for(const QString &path : app.arguments().mid(1)) {
+		QFile file(path);
+		if(file.open(QIODevice::ReadOnly)) page_list << file.readAll();
+		else qDebug() << "Failed to open" << path;
+	}
+
+	if(page_list.isEmpty()) page_list << makePage();
+
+	// Cover and largest icon size, then smallest page preview
+	for(int size : {512, 256, 128}) {
+		run(QString("Full decode + scaled() %1px").arg(size), page_list,
+			[size](const QByteArray &data) {
+				return QImage::fromData(data).scaled(size, size, Qt::KeepAspectRatio);
+			});
+		run(QString("decodeImage() %1px").arg(size), page_list, [size](const QByteArray &data) {
+			return ComicFile::decodeImage(data, size);
+		});
+	}
+
+	return 0;
+}
\ No newline at end of file
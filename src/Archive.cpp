@@ -1,6 +1,9 @@
 #define ARCHIVE_CPP
 #include "Archive.hpp"
 
+#include <QCryptographicHash>
+#include <QTemporaryDir>
+
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  *									ARCHIVE PUBLIC METHODS 										 *
@@ -8,19 +11,21 @@
 
 
 /**
- * Copy constructor.
+ * Copy constructor, nothing is listed again and no process is started.
  */
-Archive::Archive(const Archive &archive) : QObject() {
-	process					=	new QProcess(this);
+Archive::Archive(const Archive &archive) {
 	file_list				=	archive.file_list;
 	path					=	archive.path;
 	type					=	archive.type;
+	content_hash			=	archive.content_hash;
 	supported_image_types	=	archive.supported_image_types;
 }
 
 
 /**
- * Initializes QProcess, gets list of archive contents, and stores in file_list.
+ * Gets list of archive contents, and stores in file_list. The technical
+ * listing ("7z l -slt") also has the size and CRC of every entry, so content_hash is built from it
+ * at the same time without extracting anything.
  *
  * Possible Exceptions:
  * - PROCESS_ERROR may be thrown if shell command fails.
@@ -30,74 +35,53 @@ Archive::Archive(const QString &_path) : path(_path) {
 
 	QString output; // Used to capture output from 7z command
 	QStringList output_list; // List of lines from output (output split at "\n")
-	QString column_header; // String that "7z l" uses as column header for content list
-	QString out_body_sep; // A string that the "7z l" command uses to separate it's list of contents
+	QStringList page_entry_list; // "name size crc" of each image, used for content_hash
+	QString name, size, crc; // Properties of entry currently being read
 	// While looping through output_list, are we in actual content list?
 	bool in_content_list = false;
-	int name_index = 0;
-
-	process = new QProcess(this);
-
-	// Connect to signal for error handling
-	connect(process, SIGNAL(error(QProcess::ProcessError)),
-			SLOT(processError(QProcess::ProcessError)));
-
-	// Connect to signal for ErrorOutput
-	connect(process, SIGNAL(readyReadStandardError()), SLOT(outputStdError()));
-
-	// Set archive type
-	if(path.endsWith("7z", Qt::CaseInsensitive) || path.endsWith("cb7", Qt::CaseInsensitive)) {
-		type = "7z";
-	}
-
-	if(path.endsWith("zip", Qt::CaseInsensitive) || path.endsWith("cbz", Qt::CaseInsensitive)) {
-		type = "zip";
-	}
-
-	if(path.endsWith("rar", Qt::CaseInsensitive) || path.endsWith("cbr", Qt::CaseInsensitive)) {
-		type = "rar";
-	}
 
-	// Get list of archive contents
-	run("7z", {"l", path} );
+	initType();
 
-	output = process->readAllStandardOutput();
+	// Get list of archive contents, one block of "Key = Value" lines per entry
+	output = run("7z", {"l", "-slt", path} );
 
-	// Create QStringList from output separating by whitespace
+	// Create QStringList from output separating by line, and add a blank line so that the last
+	// entry is finished like the rest
 	output_list = output.split(QRegExp("\\n"));
-	// Prepare strings for comparison
-	column_header = "   Date      Time    Attr         Size   Compressed  Name";
-	out_body_sep = "------------------- ----- ------------ ------------  ------------------------";
+	output_list << QString();
 
-	// Loop through output list getting all image names
+	// Loop through output list getting properties of every entry
 	for(int i = 0; i < output_list.size(); i++) {
-		// When at "column header" line, get index where Name is
-		if(output_list[i] == column_header) {
-			name_index = output_list[i].indexOf("Name");
+		// Entries start after separator, everything before it describes the archive itself
+		if(!in_content_list) {
+			if(output_list[i] == "----------") in_content_list = true;
 		}
 
-		// If line is body separater, decide if we are in content list or not
-		else if(output_list[i] == out_body_sep) {
-			if(in_content_list) {
-				in_content_list = false;
-			}
+		else if(output_list[i].startsWith("Path = ")) name = output_list[i].mid(7);
+		else if(output_list[i].startsWith("Size = ")) size = output_list[i].mid(7);
+		else if(output_list[i].startsWith("CRC = ")) crc = output_list[i].mid(6);
 
-			else {
-				in_content_list = true;
+		// Blank line finishes entry
+		else if(output_list[i].trimmed().isEmpty() && !name.isEmpty()) {
+			file_list << name;
+			if(supported_image_types.isSupported(name)) {
+				page_entry_list << name + " " + size + " " + crc;
 			}
-		}
 
-		// Else, if we are in content list, use name_index to get actual file name from line
-		else if(in_content_list) {
-			file_list << output_list[i].mid(name_index);
+			name.clear();
+			size.clear();
+			crc.clear();
 		}
 	}
+
+	// Sort so that fingerprint doesn't depend on the order entries are stored in
+	page_entry_list.sort();
+	content_hash = QCryptographicHash::hash(page_entry_list.join("\n").toUtf8(),
+			QCryptographicHash::Md5).toHex();
 }
 
 
-Archive::~Archive() {
-	delete process;
-}
+Archive::~Archive() {}
 
 
 int Archive::getNumOfPages() const {
@@ -126,19 +110,35 @@ bool Archive::hasComicInfo() const {
 
 
 /**
- * Gets ComicInfo.xml and returns entire file contents as QString. If ComicInfo.xml does not exist,
- * then a blank/null QString is returned.
+ * Points archive at path, for when the file has been moved or renamed, contents aren't listed
+ * again since they haven't changed.
+ */
+void Archive::setPath(const QString &_path) {
+	path = _path;
+	initType();
+}
+
+
+/**
+ * Returns fingerprint of archive's pages (md5 hash of the name, size, and CRC of each image), it
+ * doesn't change when only ComicInfo.xml is changed.
+ */
+QByteArray Archive::getContentHash() const { return content_hash; }
+
+
+/**
+ * Gets ComicInfo.xml and returns entire file contents as raw UTF-8. If ComicInfo.xml does not
+ * exist, then a null QByteArray is returned.
  *
  * Possible Exceptions:
  * - PROCESS_ERROR may be thrown if shell command fails.
  */
-QString Archive::getXmlBuf() const {
+QByteArray Archive::getXmlBuf() const {
 	// Exec 7z command to extract file (7z can extract any archive format)
 	if(hasComicInfo()) {
-		run(QString("7z"), {"e", "-so", path, "ComicInfo.xml"} );
-		return process->readAllStandardOutput();
+		return run(QString("7z"), {"e", "-so", path, "ComicInfo.xml"} );
 	} else {
-		return QString();
+		return QByteArray();
 	}
 }
 
@@ -151,8 +151,14 @@ QString Archive::getXmlBuf() const {
  * - PROCESS_ERROR may be thrown if the shell command fails in any way.
  */
 void Archive::setComicInfo(const QByteArray &raw_xml) {
-	// Prepare path string for temp ComicInfo.xml
-	QString tmp_file_path = config->getTempDir().absolutePath() + "/ComicInfo.xml";
+	// Prepare path string for temp ComicInfo.xml, each write gets it's own dir since several
+	// comics may be written at once, but the file must be named ComicInfo.xml
+	QTemporaryDir tmp_dir(config->getTempPath() + "/xml-XXXXXX");
+	if(!tmp_dir.isValid()) {
+		throw eComics::Exception(eComics::FILE_ERROR, "Archive::setComicInfo()",
+				QString("Failed to create temp dir in ") + config->getTempPath());
+	}
+	QString tmp_file_path = tmp_dir.path() + "/ComicInfo.xml";
 	// Prepare temp file for writing
 	QFile file(tmp_file_path);
 	if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
@@ -185,13 +191,13 @@ void Archive::setComicInfo(const QByteArray &raw_xml) {
 
 
 /**
- * Extracts page at index to temp dir, returns full path to extracted page.
+ * Extracts page at index to dir_path, returns full path to extracted page.
  *
  * Possible Exceptions:
  * - LOGIC_ERROR may be thrown if page at index doesn't exist.
  * - PROCESS_ERROR may be thrown if shell command fails in any way.
  */
-QString Archive::extractPage(const int index) const {
+QString Archive::extractPage(const int index, const QString &dir_path) const {
 	int count = 0; // Used to keep track of how many images we have counted
 
 	for(int i = 0; i < file_list.size(); i++) {
@@ -201,9 +207,8 @@ QString Archive::extractPage(const int index) const {
 
 		if(supported_image_types.isSupported(file_list[i])) {
 			if(count == index) {
-				run("7z", {"e", path, file_list[i], "-aoa", QString("-o") +
-							config->getTempDir().absolutePath()} );
-				return config->getTempDir().absolutePath() + "/" + file_name;
+				run("7z", {"e", path, file_list[i], "-aoa", QString("-o") + dir_path} );
+				return dir_path + "/" + file_name;
 			} else {
 				count++;
 			}
@@ -222,58 +227,70 @@ QString Archive::extractPage(const int index) const {
 
 
 /**
- * This is a conveniece function for QProcess::start(). Simply runs a command with arguments and
- * waits for it to finish, if it fails then an exception is thrown.
- *
- * Possible Exceptions:
- * - PROCESS_ERROR may be thrown if shell command fails in any way.
+ * Sets archive type from extension of path.
  */
-void Archive::run(const QString &program, const QStringList &args) const {
-	process->start(program, args);
-
-	// Wait for process to finish before continuing
-	if(!process->waitForFinished(5000)) {
-		// If process fails to finish, throw exception
-		throw eComics::Exception(eComics::PROCESS_ERROR, "Archive::run()", program +
-				" Failed to Finish");
+void Archive::initType() {
+	if(path.endsWith("7z", Qt::CaseInsensitive) || path.endsWith("cb7", Qt::CaseInsensitive)) {
+		type = "7z";
+	}
+
+	if(path.endsWith("zip", Qt::CaseInsensitive) || path.endsWith("cbz", Qt::CaseInsensitive)) {
+		type = "zip";
+	}
+
+	if(path.endsWith("rar", Qt::CaseInsensitive) || path.endsWith("cbr", Qt::CaseInsensitive)) {
+		type = "rar";
 	}
 }
 
 
 /**
- * Slot which connects to error signal from QProcess, throws appropriate exception.
+ * This is a conveniece function for QProcess::start(). Simply runs a command with arguments, waits
+ * for it to finish, and returns it's standard output, if it fails then an exception is thrown. Each
+ * call gets it's own QProcess, so an Archive can be shared between threads.
+ *
+ * Possible Exceptions:
+ * - PROCESS_ERROR may be thrown if shell command fails in any way.
  */
-void Archive::processError(QProcess::ProcessError error) {
-	switch(error) {
-		case QProcess::FailedToStart:
-			throw eComics::Exception(eComics::PROCESS_ERROR, "Archive::run()", process->program() +
-					" failed to start");
-
-		case QProcess::Crashed:
-			throw eComics::Exception(eComics::PROCESS_ERROR, "Archive::run()", process->program() +
-					" crashed");
-
-		case QProcess::Timedout:
-			throw eComics::Exception(eComics::PROCESS_ERROR, "Archive::run()", process->program() +
-					" timedout");
-
-		case QProcess::WriteError:
-			throw eComics::Exception(eComics::PROCESS_ERROR, "Archive::run()", process->program() +
-					" write error");
-
-		case QProcess::ReadError:
-			throw eComics::Exception(eComics::PROCESS_ERROR, "Archive::run()", process->program() +
-					" read error");
-
-		case QProcess::UnknownError:
-			throw eComics::Exception(eComics::PROCESS_ERROR, "Archive::run()", process->program() +
-					" unknown error");
-
+QByteArray Archive::run(const QString &program, const QStringList &args) const {
+	QProcess process;
+	process.start(program, args);
+
+	// Wait for process to finish before continuing, if it fails throw exception
+	if(!process.waitForFinished(5000) || process.exitStatus() == QProcess::CrashExit) {
+		QString msg;
+		switch(process.error()) {
+			case QProcess::FailedToStart:
+				msg = " failed to start";
+				break;
+
+			case QProcess::Crashed:
+				msg = " crashed";
+				break;
+
+			case QProcess::Timedout:
+				msg = " timedout";
+				break;
+
+			case QProcess::WriteError:
+				msg = " write error";
+				break;
+
+			case QProcess::ReadError:
+				msg = " read error";
+				break;
+
+			case QProcess::UnknownError:
+			default:
+				msg = " Failed to Finish";
+				break;
+		}
 
+		throw eComics::Exception(eComics::PROCESS_ERROR, "Archive::run()", program + msg);
 	}
-}
 
+	QByteArray error_output = process.readAllStandardError();
+	if(!error_output.isEmpty()) qDebug() << error_output;
 
-void Archive::outputStdError() {
-	qDebug() << process->readAllStandardError();
+	return process.readAllStandardOutput();
 }
\ No newline at end of file
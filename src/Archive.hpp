@@ -29,32 +29,33 @@
 #include "Config.hpp"
 
 
-class Archive : public QObject {
-	Q_OBJECT
-
+/**
+ * Lists and extracts from archives with 7z (and writes rar with rar). Once constructed an Archive
+ * is never changed by reading from it, so it can be shared by several ComicFiles and threads.
+ */
+class Archive {
 	public:
 		Archive() {};
 		Archive(const Archive &archive);
 		Archive(const QString &_path);
 		~Archive();
+		void setPath(const QString &_path);
 		int getNumOfPages() const;
 		bool hasComicInfo() const;
-		QString getXmlBuf() const;
+		QByteArray getContentHash() const;
+		QByteArray getXmlBuf() const;
 		void setComicInfo(const QByteArray &raw_xml);
-		QString extractPage(const int index) const;
+		QString extractPage(const int index, const QString &dir_path) const;
 
 	private:
-		QProcess *process;
 		QStringList file_list;
 		QString path;
 		QString type;
+		QByteArray content_hash; // Fingerprint of pages only, see getContentHash()
 		FileTypeList supported_image_types; // Stores list of supported image file types
 
-		void run(const QString &program, const QStringList &args) const;
-
-	private slots:
-		void processError(QProcess::ProcessError error);
-		void outputStdError();
+		void initType();
+		QByteArray run(const QString &program, const QStringList &args) const;
 };
 
 
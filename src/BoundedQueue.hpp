@@ -0,0 +1,163 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * BoundedQueue.hpp                                                            *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef BOUNDEDQUEUE_HPP
+#define BOUNDEDQUEUE_HPP
+
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+
+/**
+ * template<class T> class BoundedQueue
+ *
+ * A fixed size, lock-free, multi-producer multi-consumer queue (a ring buffer where each cell has a
+ * sequence number that tells producers and consumers whose turn it is). Used to connect stages of
+ * a pipeline, push() blocks while the queue is full, which keeps a fast stage from running ahead of
+ * a slow one. Once producers are done they call close(), pop() then returns false when the queue
+ * is empty. T must be cheap to copy, pipelines pass pointers.
+ */
+template<class T>
+class BoundedQueue {
+	public:
+		/**
+		 * Capacity is rounded up to a power of 2.
+		 */
+		BoundedQueue(const size_t capacity) : enqueue_pos(0), dequeue_pos(0), closed(false) {
+			size_t size = 2;
+			while(size < capacity) size <<= 1;
+
+			buffer	=	new Cell[size];
+			mask	=	size - 1;
+			for(size_t i = 0; i < size; i++) buffer[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		~BoundedQueue() {
+			delete[] buffer;
+		}
+
+		/**
+		 * Returns false if queue is full.
+		 */
+		bool tryPush(const T &value) {
+			size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+			while(true) {
+				Cell *cell = &buffer[pos & mask];
+				size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(pos);
+
+				if(diff == 0) {
+					// Cell is free, claim it
+					if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						cell->value = value;
+						cell->sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				} else if(diff < 0) {
+					return false; // Full
+				} else {
+					pos = enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/**
+		 * Returns false if queue is empty.
+		 */
+		bool tryPop(T &value) {
+			size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+
+			while(true) {
+				Cell *cell = &buffer[pos & mask];
+				size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(pos + 1);
+
+				if(diff == 0) {
+					// Cell is filled, claim it
+					if(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						value = cell->value;
+						cell->sequence.store(pos + mask + 1, std::memory_order_release);
+						return true;
+					}
+				} else if(diff < 0) {
+					return false; // Empty
+				} else {
+					pos = dequeue_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/**
+		 * Blocks while queue is full.
+		 */
+		void push(const T &value) {
+			while(!tryPush(value)) backoff();
+		}
+
+		/**
+		 * Blocks while queue is empty, returns false once queue is closed and empty.
+		 */
+		bool pop(T &value) {
+			while(!tryPop(value)) {
+				// Check again after seeing closed, a value may have been pushed just before close()
+				if(closed.load(std::memory_order_acquire)) return tryPop(value);
+				backoff();
+			}
+
+			return true;
+		}
+
+		/**
+		 * Called by producers when nothing more will be pushed.
+		 */
+		void close() {
+			closed.store(true, std::memory_order_release);
+		}
+
+		bool isClosed() const {
+			return closed.load(std::memory_order_acquire);
+		}
+
+	private:
+		struct Cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		Cell *buffer;
+		size_t mask;
+		// Keep producer and consumer positions on separate cache lines
+		alignas(64) std::atomic<size_t> enqueue_pos;
+		alignas(64) std::atomic<size_t> dequeue_pos;
+		std::atomic<bool> closed;
+
+		/**
+		 * Stages wait on disk or on other processes, so sleeping beats spinning.
+		 */
+		static void backoff() {
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+};
+
+
+#endif
\ No newline at end of file
@@ -3,10 +3,16 @@
 #include <cmath>
 #include <QDate>
 #include <QByteArray>
+#include <QBuffer>
 #include <QCryptographicHash>
+#include <QImageReader>
+#include <QTemporaryDir>
 #include <QXmlStreamReader>
 
+#include "ImageScaler.hpp"
 #include "Library.hpp"
+#include "MetadataWriter.hpp"
+#include "ThumbnailService.hpp"
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  *									COMICFILE PUBLIC METHODS 									 *
@@ -21,6 +27,9 @@ ComicFile::ComicFile() {
 }
 
 
+/**
+ * Copies aren't connected to their info, see operator =().
+ */
 ComicFile::ComicFile(const ComicFile &comic) : QFile(comic.getPath()) {
 	*this = comic;
 }
@@ -45,11 +54,21 @@ ComicFile::ComicFile(const QString &path) : QFile(path) {
 	if(library->contains(path)) {
 		in_library = true;
 
-		// If md5 hash matches then just copy metadata, otherwise parse it from file
+		// If md5 hash matches then just copy metadata, if only metadata changed (pages are the same)
+		// then just reload it, otherwise parse it from file
 		const ComicFile &comic = library->at(path);
 		if(getMd5Hash() == comic.getMd5Hash()) {
-			info = comic.info;
-		} else populateComicInfo();
+			info			=	comic.info;
+			content_hash	=	comic.content_hash;
+			xml_hash		=	comic.xml_hash;
+			cover_hash		=	comic.cover_hash;
+		} else {
+			// Cover is only kept if pages are the same, reloadComicInfo() drops it if cover moved
+			initContentHash();
+			bool same_pages = !content_hash.isEmpty() && content_hash == comic.content_hash;
+			if(same_pages) cover_hash = comic.cover_hash;
+			if(!same_pages || !reloadComicInfo(comic.info)) populateComicInfo();
+		}
 
 		// Make sure that appropriate attributes are in one of the lists
 		parseAttributeLists();
@@ -70,16 +89,27 @@ ComicFile::ComicFile(const QString &path) : QFile(path) {
 
 /**
  * Initialize a ComicFile with ComicInfo info if md5_hash matches file, otherwise just get info from
- * file itself.
+ * file itself. If _file_stat is given and the file on disk still has the same stat, then md5_hash is
+ * trusted as is and the file isn't re-hashed. _content_hash, _xml_hash, and _cover_hash are only
+ * kept along with info.
  */
-ComicFile::ComicFile(const QString &path, const ComicInfo &_info, const QByteArray &md5_hash)
-		: QFile(path) {
+ComicFile::ComicFile(const QString &path, const ComicInfo &_info, const QByteArray &md5_hash,
+		const FileStat &_file_stat, const QByteArray &_content_hash, const QByteArray &_xml_hash,
+		const QByteArray &_cover_hash) : QFile(path) {
 	if(!initFileType()) return;
-	try { initMd5Hash(); } catch(const eComics::Exception &e) { e.printMsg(); }
+
+	if(!md5_hash.isEmpty() && !_file_stat.isNull() && FileStat::fromPath(path) == _file_stat) {
+		this->md5_hash	=	md5_hash;
+		file_stat		=	_file_stat;
+	} else try { initMd5Hash(); } catch(const eComics::Exception &e) { e.printMsg(); }
 
 	// Get comic info
-	if(this->md5_hash == md5_hash) info = _info;
-	else populateComicInfo();
+	if(this->md5_hash == md5_hash) {
+		info			=	_info;
+		content_hash	=	_content_hash;
+		xml_hash		=	_xml_hash;
+		cover_hash		=	_cover_hash;
+	} else populateComicInfo();
 
 	info.setParent(this);
 
@@ -97,14 +127,104 @@ ComicFile::ComicFile(const QString &path, const ComicInfo &_info, const QByteArr
 }
 
 
-ComicFile::~ComicFile() {
-	if(archive != nullptr) {
-		delete archive;
+/**
+ * Initialize a new ComicFile (one that isn't in library yet) whose md5 hash has already been
+ * generated. The thumbnail isn't verified, so that it can be done separately with verifyThumb(),
+ * and library isn't touched, so this is safe to use from several threads at once. Like a copy, it
+ * isn't connected to it's info, the copy library makes of it is (see operator =()).
+ */
+ComicFile::ComicFile(const QString &path, const QByteArray &md5_hash, const FileStat &file_stat)
+		: QFile(path) {
+	if(!initFileType()) return;
+
+	this->md5_hash		=	md5_hash;
+	this->file_stat		=	file_stat;
+	in_library			=	false;
+
+	populateComicInfo();
+	info.setParent(this);
+}
+
+
+/**
+ * Move constructor, takes comic's backend and hashes without copying them. Like copies, it isn't
+ * connected to it's info.
+ */
+ComicFile::ComicFile(ComicFile &&comic) : QFile(comic.getPath()) {
+	*this = std::move(comic);
+}
+
+
+ComicFile::~ComicFile() {}
+
+
+/**
+ * Returns true if path has the extension of a supported comic file type, so files can be filtered
+ * before doing any work on them.
+ */
+bool ComicFile::isSupportedType(const QString &path) {
+	static const FileTypeList supported_types( {"zip", "cbz", "7z", "cb7", "rar", "cbr", "pdf"} );
+	return supported_types.isSupported(path);
+}
+
+
+/**
+ * Returns md5 hash of file at path as hex.
+ *
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if file fails to open, or if file fails to be read.
+ */
+QByteArray ComicFile::generateMd5Hash(const QString &path) {
+	QFile file(path);
+	if(!file.open(QIODevice::ReadOnly)) {
+		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::generateMd5Hash()",
+				QString("Failed to open ") + path + " for reading");
+	}
+
+	QCryptographicHash hash(QCryptographicHash::Md5);
+
+	if(!hash.addData(&file)) {
+		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::generateMd5Hash()",
+				QString("Failed to read ") + path);
 	}
 
-	if(pdf != nullptr) {
-		delete pdf;
+	return hash.result().toHex();
+}
+
+
+/**
+ * Decodes image from data, scaled to fit size x size preserving aspect ratio, if size is 0
+ * (default) then it is not scaled. Returns a null QImage if data can't be decoded.
+ *
+ * Jpeg (most pages, and all rendered pdf pages) is decoded with libjpeg's scaled IDCT, which skips
+ * straight to 1/2, 1/4, or 1/8 size, as far as it can without going below size. ImageScaler scales
+ * the rest of the way, so a full size page is never decoded just to make a thumbnail.
+ */
+QImage ComicFile::decodeImage(const QByteArray &data, const int size) {
+	QBuffer buffer;
+	buffer.setData(data);
+	QImageReader reader(&buffer);
+
+	// Only reads the header
+	QSize image_size = reader.size();
+	if(size && reader.format() == "jpeg" && image_size.isValid()) {
+		QSize target_size = image_size.scaled(size, size, Qt::KeepAspectRatio);
+		int denom = 8;
+		while(denom > 1 && (image_size.width() / denom < target_size.width() ||
+				image_size.height() / denom < target_size.height())) {
+			denom /= 2;
+		}
+
+		// Qt picks libjpeg's scale from the scaled size
+		if(denom > 1) {
+			reader.setScaledSize(QSize(image_size.width() / denom, image_size.height() / denom));
+		}
 	}
+
+	QImage image = reader.read();
+	if(size) image = ImageScaler::scaled(image, size, size);
+
+	return image;
 }
 
 
@@ -145,10 +265,25 @@ void ComicFile::move() {
 		new_file_name = getPath().mid(getPath().lastIndexOf("/") + 1);
 	}
 
+	// Write queued metadata before file moves, if it fails then let the next save rewrite it
+	QString old_path = getPath();
+	if(!metadata_writer->flush(old_path)) xml_hash.clear();
+
 	// Ensure new path exists, then move file
 	dir.mkpath(new_dir_path);
-	dir.rename(getPath(), new_dir_path + new_file_name);
-	setFileName(new_dir_path + new_file_name);
+	dir.rename(old_path, new_dir_path + new_file_name);
+	metadata_writer->rename(old_path, new_dir_path + new_file_name);
+	setPath(new_dir_path + new_file_name);
+}
+
+
+/**
+ * Points ComicFile at path after the file was moved or renamed outside of eComics, metadata and md5
+ * hash are kept since the file itself hasn't changed.
+ */
+void ComicFile::setPath(const QString &path) {
+	setFileName(path);
+	file_stat = FileStat::fromPath(path);
 }
 
 
@@ -166,43 +301,34 @@ void ComicFile::move() {
  */
 void ComicFile::extractPage(const int index, const QString &path, const QString &file_name,
 		const int size) const {
-	QString temp_image_path;
-
-	switch(type) {
-		case TYPE_ARCHIVE:
-			// This may throw a LOGIC_ERROR() or PROCESS_ERROR()
-			temp_image_path = archive->extractPage(index);
-			break;
-
-		case TYPE_PDF:
-			// This may throw a few exceptions
-			temp_image_path = pdf->extractPage(index);
-			break;
-
-		case TYPE_UNSUPPORTED:
-		default:
-			throw eComics::Exception(eComics::LOGIC_ERROR, "ComicFile::extractPage()",
-					this->fileName() + " is an unsupported type");
-	}
-
-	// Convert image if necessary, and move to path
-	QImage image = (size) ? QImage(temp_image_path).scaled(size, size, Qt::KeepAspectRatio) :
-			QImage(temp_image_path);
+	// Convert image if necessary, and save to path
+	QImage image = decodeImage(readPage(index), size);
 	if(image.isNull()) {
 		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::extractPage()",
-				QString("Failed to open ") + temp_image_path);
+				QString("Failed to decode page ") + QString::number(index) + " of " + getPath());
 	}
 
 	if(!image.save(path + "/" + file_name)) {
 		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::extractPage()",
 				QString("Failed to save ") + path + "/" + file_name);
 	}
+}
 
-	// Delete temp image
-	if(!QFile::remove(temp_image_path)) {
-		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::extractPage()",
-				QString("Failed to remove ") + temp_image_path);
-	}
+
+/**
+ * Returns encoded image of page with index, exactly as stored in archive (pdf pages are rendered to
+ * jpeg).
+ *
+ * Possible Exceptions:
+ * - See PageSource::readPage().
+ */
+QByteArray ComicFile::readPage(const int index) const {
+	return getPageSource().readPage(index);
+}
+
+
+ComicFile::PageSource ComicFile::getPageSource() const {
+	return PageSource{getPath(), archive, pdf};
 }
 
 
@@ -301,32 +427,42 @@ int ComicFile::getNumOfPages() const {
 QString ComicFile::getFileName() const { return getPath().mid(getPath().lastIndexOf('/') + 1); }
 QString ComicFile::getPath() const { return fileName(); }
 QByteArray ComicFile::getMd5Hash() const { return md5_hash; }
+FileStat ComicFile::getFileStat() const { return file_stat; }
 
 
 /**
- * Generate name of thumbnail based on metadata.
+ * Returns fingerprint of comic's pages, which unlike md5 hash doesn't change when only metadata is
+ * changed, empty if unknown.
  */
-QString ComicFile::getThumbName(const ComicInfo &_info) const {
-	QString thumb_file_name;
+QByteArray ComicFile::getContentHash() const { return content_hash; }
 
-	// If no ComicInfo object passed as argument, use internal info to generate thumb path
-	if(_info.isNull()) {
-		thumb_file_name	=	info.getSeries() + "-" + info.getVolume() + "-" +
-							info.getNumber() + "-" + info.getTitle() + ".jpg";
-	} else {
-		thumb_file_name	=	_info.getSeries() + "-" + _info.getVolume() + "-" +
-							_info.getNumber() + "-" + _info.getTitle() + ".jpg";
-	}
 
-	return thumb_file_name;
-}
+/**
+ * Returns md5 hash (as hex) of ComicInfo xml last read from or written to file, empty if unknown.
+ */
+QByteArray ComicFile::getXmlHash() const { return xml_hash; }
+
+
+/**
+ * Returns md5 hash (as hex) of cover image, empty if thumbnail hasn't been generated yet.
+ */
+QByteArray ComicFile::getCoverHash() const { return cover_hash; }
 
 
 /**
- * This is a convenience function that returns full path to thumbnail (including it's file name).
+ * Returns thumbnail at the stored size nearest to size (see ThumbnailService::getStoredSize()), or
+ * a null QImage if it hasn't been generated yet. It's keyed by cover image, so it doesn't change
+ * when metadata is edited.
  */
-QString ComicFile::getThumbPath(const ComicInfo &_info) const {
-	return config->getThumbDir().absolutePath() + "/" + getThumbName(_info);
+QImage ComicFile::getThumb(const int size) const {
+	QByteArray hash = findCoverHash();
+	return hash.isEmpty() ? QImage() : thumbnail_service->getThumb(hash, size);
+}
+
+
+bool ComicFile::hasThumb() const {
+	QByteArray hash = findCoverHash();
+	return !hash.isEmpty() && thumbnail_service->hasThumb(hash);
 }
 
 
@@ -336,12 +472,11 @@ bool ComicFile::isNull() const {
 
 
 /**
- * Saves ComicInfo to xml in comic file.
+ * Saves ComicInfo to xml in comic file. The write itself is queued on MetadataWriter, so this
+ * returns right away, failed writes are reported by MetadataWriter::failed().
  *
  * Possible Exceptions:
  * - LOGIC_ERROR may be thrown if ComicFile is an unsupported type.
- * - FILE_ERROR may be thrown from Archive::setComicInfo().
- * - PROCESS_ERROR may be thrown if shell command from Archive fails in any way.
  */
 void ComicFile::save() {
 	// Prepare buff to be written
@@ -369,49 +504,32 @@ void ComicFile::save() {
 
 	// Create Pages element, and fill with a Page for each image in ComicFile
 	writer.writeStartElement(ns_uri, "Pages");
-	for(int i = 0; i < info.page_list.size(); i++) {
-		writer.writeEmptyElement(ns_uri, "Page");
-		// Image is a required field, so it will always be filled
-		writer.writeAttribute(ns_uri, "Image", info.page_list[i].getImage());
-
-		// For the rest, if they are empty don't add them
-		if(!info.page_list[i].getType().isEmpty()) {
-			writer.writeAttribute(ns_uri, "Type", info.page_list[i].getType());
-		}
-
-		if(!info.page_list[i].getDoublePage().isEmpty()) {
-			writer.writeAttribute(ns_uri, "DoublePage", info.page_list[i].getDoublePage());
-		}
-
-		if(!info.page_list[i].getImageSize().isEmpty()) {
-			writer.writeAttribute(ns_uri, "ImageSize", info.page_list[i].getImageSize());
-		}
-
-		if(!info.page_list[i].getKey().isEmpty()) {
-			writer.writeAttribute(ns_uri, "Key", info.page_list[i].getKey());
-		}
-
-		if(!info.page_list[i].getImageWidth().isEmpty()) {
-			writer.writeAttribute(ns_uri, "ImageWidth", info.page_list[i].getImageWidth());
-		}
-
-		if(!info.page_list[i].getImageHeight().isEmpty()) {
-			writer.writeAttribute(ns_uri, "ImageHeight", info.page_list[i].getImageHeight());
-		}
-	}
+	for(const Page &page : info.getPageList()) page.writeXml(writer, ns_uri);
 
 	writer.writeEndElement(); // </Pages>
 
 	writer.writeEndElement(); // </ComicInfo>
 	writer.writeEndDocument();
 
+	// Skip write if file already has exactly this xml, e.g. when a correction changed nothing. If
+	// xml is still queued for file then that's what it will end up with, so it's compared instead,
+	// otherwise reverting an edit before it's written would be skipped and the edit would land
+	QByteArray new_xml_hash = QCryptographicHash::hash(xml_buff, QCryptographicHash::Md5).toHex();
+	QByteArray queued_hash = metadata_writer->getQueuedHash(getPath());
+	if(new_xml_hash == (queued_hash.isEmpty() ? xml_hash : queued_hash)) {
+		dirty = false;
+		return;
+	}
+
+	// Write in background, stat and xml_hash are updated by Library once write has landed, so a
+	// write that's lost doesn't cause later saves of the same xml to be skipped
 	switch(type) {
 		case TYPE_ARCHIVE:
-			archive->setComicInfo(xml_buff);
+			metadata_writer->enqueue(getPath(), xml_buff, MetadataWriter::ARCHIVE_FORMAT);
 			break;
 
 		case TYPE_PDF:
-			pdf->setComicInfo(xml_buff);
+			metadata_writer->enqueue(getPath(), xml_buff, MetadataWriter::PDF_FORMAT);
 			break;
 
 		case TYPE_UNSUPPORTED:
@@ -420,8 +538,6 @@ void ComicFile::save() {
 					" is an unsupported type");
 	}
 
-	// Update MD5 Hash
-	initMd5Hash();
 	dirty = false;
 }
 
@@ -433,8 +549,15 @@ void ComicFile::startEditing() {
 
 
 void ComicFile::finishEditing() {
+	// Deliver changes made while editing now, so they're handled here instead of one by one later
+	info.flushChanges();
+
 	if(dirty) {
-		// Make sure thumb is updated properly
+		// Make sure thumb is updated properly, in case a different page was made the cover
+		if(info.getPageList().getFrontCover() != original_info.getPageList().getFrontCover()) {
+			cover_hash.clear();
+		}
+
 		verifyThumb();
 
 		// Save
@@ -447,18 +570,48 @@ void ComicFile::finishEditing() {
 }
 
 
+/**
+ * Copying is cheap, Archive/Pdf are shared rather than copied, and the rest is implicitly shared.
+ * Signals aren't connected here, they stay as they were for the comic being assigned to, so most
+ * copies (temporaries, lists of comics to show) never connect at all. Editing a copy that isn't
+ * connected doesn't save it, comics are edited through library, which connects the comics it
+ * holds.
+ */
 ComicFile & ComicFile::operator =(const ComicFile &comic) {
-	if(getPath().isEmpty()) QFile(comic.getPath());
-
-	info		=	comic.info;
-	type		=	comic.type;
-	ext			=	comic.ext;
-	md5_hash	=	comic.md5_hash;
-	ns_uri		=	comic.ns_uri;
-	dirty		=	comic.dirty;
-	if(comic.pdf != nullptr) pdf = new Pdf(*comic.pdf);
-	if(comic.archive != nullptr) archive = new Archive(*comic.archive);
-	connectSignals();
+	if(getPath() != comic.getPath()) QFile::setFileName(comic.getPath());
+
+	info			=	comic.info;
+	type			=	comic.type;
+	ext				=	comic.ext;
+	md5_hash		=	comic.md5_hash;
+	file_stat		=	comic.file_stat;
+	content_hash	=	comic.content_hash;
+	xml_hash		=	comic.xml_hash;
+	cover_hash		=	comic.cover_hash;
+	ns_uri			=	comic.ns_uri;
+	dirty			=	comic.dirty;
+	archive			=	comic.archive;
+	pdf				=	comic.pdf;
+
+	return *this;
+}
+
+
+ComicFile & ComicFile::operator =(ComicFile &&comic) {
+	if(getPath() != comic.getPath()) QFile::setFileName(comic.getPath());
+
+	info			=	comic.info;
+	type			=	comic.type;
+	ext				=	std::move(comic.ext);
+	md5_hash		=	std::move(comic.md5_hash);
+	file_stat		=	comic.file_stat;
+	content_hash	=	std::move(comic.content_hash);
+	xml_hash		=	std::move(comic.xml_hash);
+	cover_hash		=	std::move(comic.cover_hash);
+	ns_uri			=	std::move(comic.ns_uri);
+	dirty			=	comic.dirty;
+	archive			=	std::move(comic.archive);
+	pdf				=	std::move(comic.pdf);
 
 	return *this;
 }
@@ -477,37 +630,57 @@ bool ComicFile::operator ==(const ComicFile &comic) {
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 
+/**
+ * Returns cover_hash, a thumbnail that was just generated is found through ThumbnailService until
+ * Library records it's cover hash.
+ */
+QByteArray ComicFile::findCoverHash() const {
+	return cover_hash.isEmpty() ? thumbnail_service->getCoverHash(md5_hash) : cover_hash;
+}
+
+
 void ComicFile::connectSignals() {
-	// Make connection to MetadataTag queued so it can be properly accessed from a QThread
-	qRegisterMetaType<MetadataTag>("MetadataTag");
-	connect(&info, SIGNAL(tagChanged(const MetadataTag &, const QString)), this,
-		SLOT(onInfoChanged(const MetadataTag &, const QString)));
-	connect(this, SIGNAL(addedToLibrary()), this, SLOT(onAddedToLibrary()));
+	// Register ChangeSet so the connection can be queued if info is accessed from a QThread, connect
+	// uniquely since library connects comics it's given, which may already be connected
+	qRegisterMetaType<ComicInfo::ChangeSet>("ComicInfo::ChangeSet");
+	connect(&info, SIGNAL(changed(const ComicInfo::ChangeSet &)), this,
+		SLOT(onInfoChanged(const ComicInfo::ChangeSet &)), Qt::UniqueConnection);
+	connect(this, SIGNAL(addedToLibrary()), this, SLOT(onAddedToLibrary()), Qt::UniqueConnection);
 }
 
 
 /**
- * Gets md5 hash from comic file.
+ * Gets md5 hash from comic file, and stats it so later scans can tell if it changed.
  *
  * Possible Exceptions:
  * - FILE_ERROR may be thrown if file fails to open, or if file fails to be read.
  */
 void ComicFile::initMd5Hash() {
-	if(!this->open(QIODevice::ReadOnly)) {
-		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::initMd5Hash()",
-				QString("Failed to open ") + this->fileName() + " for reading");
-	}
-
-	QCryptographicHash hash(QCryptographicHash::Md5);
+	md5_hash = generateMd5Hash(getPath());
+	file_stat = FileStat::fromPath(getPath());
+	if(in_library) library->invalidateIndex();
+}
 
-	if(!hash.addData(this)) {
-		this->close();
-		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::initMd5Hash()",
-				QString("Failed to read ") + this->fileName());
-	}
 
-	md5_hash = hash.result().toHex();
-	this->close();
+/**
+ * Gets fingerprint of pages from Archive or Pdf, left empty if it fails.
+ */
+void ComicFile::initContentHash() {
+	try {
+		switch(type) {
+			case TYPE_ARCHIVE:
+				content_hash = archive->getContentHash();
+				break;
+
+			case TYPE_PDF:
+				content_hash = pdf->getContentHash();
+				break;
+
+			case TYPE_UNSUPPORTED:
+			default:
+				break;
+		}
+	} catch(const eComics::Exception &e) { e.printMsg(); }
 }
 
 
@@ -537,10 +710,10 @@ bool ComicFile::initFileType() {
 	if(ext == "zip" || ext == "cbz" || ext == "7z" || ext == "cb7" || ext == "rar" ||
 			ext == "cbr") {
 		type	=	TYPE_ARCHIVE;
-		archive	=	new Archive(getPath());
+		archive	=	QSharedPointer<const Archive>(new Archive(getPath()));
 	} else if(ext == "pdf") {
 		type	=	TYPE_PDF;
-		pdf		=	new Pdf(getPath());
+		pdf		=	QSharedPointer<const Pdf>(new Pdf(getPath()));
 		ns_uri	=	QString("http://comicrack.cyolito.com/downloads/ComicRack/Support-Files/")
 				+	QString("ComicInfoSchema.zip");
 	}
@@ -562,7 +735,7 @@ bool ComicFile::initFileType() {
  * - LOGIC_ERROR may be thrown if ComicFile is an unsupported type.
  * - PROCESS_ERROR may be thrown if shell command in Archive fails.
  */
-QString ComicFile::getXmlBuf() const {
+QByteArray ComicFile::getXmlBuf() const {
 	switch(type) {
 		case TYPE_ARCHIVE:
 			return archive->getXmlBuf();
@@ -687,12 +860,20 @@ void ComicFile::parseAttributeLists() {
  * as possible.
  */
 void ComicFile::populateComicInfo() {
+	if(content_hash.isEmpty()) initContentHash();
+
 	try {
-		// If file has ComicInfo.xml, get it and populate comic info
-		if(hasComicInfo() && getXmlBuf().size() > 0) {
+		// If file has ComicInfo.xml, get it (only once, it may have to be extracted) and populate
+		// comic info
+		QByteArray xml_buf;
+		if(hasComicInfo()) xml_buf = getXmlBuf();
+
+		if(!xml_buf.isEmpty()) {
+			xml_hash = QCryptographicHash::hash(xml_buf, QCryptographicHash::Md5).toHex();
+
 			// Try to read XML and get metadata, if reading XML fails then parse name for metadata
 			try {
-				loadComicInfo();
+				loadComicInfo(xml_buf);
 			} catch (const eComics::Exception &e) {
 				e.printMsg();
 				qDebug() << "Parsing file name for metadata instead...";
@@ -709,11 +890,12 @@ void ComicFile::populateComicInfo() {
 		}
 
 		// Try to verify if page data is correct
-		if(info.page_list.size() != getNumOfPages()) {
-			// If page_list is incorrect, clear it out and redo it
-			info.page_list.clear();
+		if(info.getPageList().size() != getNumOfPages()) {
+			// If page list is incorrect, clear it out and redo it
+			PageList &page_list = info.editPageList();
+			page_list.clear();
 			for(int i = 0; i < getNumOfPages(); i++) {
-				info.page_list << Page(QString::number(i));
+				page_list << Page(i);
 			}
 
 			dirty = true;
@@ -768,21 +950,55 @@ void ComicFile::populateComicInfo() {
 
 
 /**
- * Populates ComicInfo object from raw xml, hasComicInfo() MUST be true, and xml MUST NOT be empty.
- *
- * Possible Exceptions:
- * - LOGIC_ERROR may be thrown if ComicFile is an unsupported type.
- * - PROCESS_ERROR may be thrown if shell command fails in Archive in getXmlBuf().
- * - XML_READ_ERROR may be thrown if fails to read xml for any reason.
+ * Re-reads only ComicInfo xml, used when metadata was changed outside eComics but pages weren't, so
+ * page list doesn't need to be checked again, and the thumbnail is kept unless a different page is
+ * now the cover. Returns false if xml is missing or needs any corrections, populateComicInfo()
+ * should be used instead.
  */
-void ComicFile::loadComicInfo() {
-	QXmlStreamReader reader;
+bool ComicFile::reloadComicInfo(const ComicInfo &old_info) {
+	bool valid = false;
 
-	// getXmlBuf may throw LOGIC_ERROR or PROCESS_ERROR on failure
 	try {
-		reader.addData(getXmlBuf());
+		QByteArray xml_buf;
+		if(hasComicInfo()) xml_buf = getXmlBuf();
+
+		if(!xml_buf.isEmpty()) {
+			loadComicInfo(xml_buf);
+			xml_hash = QCryptographicHash::hash(xml_buf, QCryptographicHash::Md5).toHex();
+			valid = !dirty && info.getPageList().size() == old_info.getPageList().size() &&
+					!info.getPublisher().isEmpty() && !info.getSeries().isEmpty() &&
+					!info.getVolume().isEmpty() && !info.getTitle().isEmpty();
+		}
 	} catch(const eComics::Exception &e) { e.printMsg(); }
 
+	// Start over for populateComicInfo()
+	if(!valid) {
+		info = ComicInfo();
+		xml_hash.clear();
+		cover_hash.clear();
+		dirty = false;
+		return false;
+	}
+
+	if(info.getPageList().getFrontCover() != old_info.getPageList().getFrontCover()) {
+		cover_hash.clear();
+	}
+
+	qDebug() << "Reloaded metadata for" << getPath();
+	return true;
+}
+
+
+/**
+ * Populates ComicInfo object from raw UTF-8 xml_buf, which MUST NOT be empty. The reader decodes
+ * xml_buf as it goes, and tag names are looked up without being copied.
+ *
+ * Possible Exceptions:
+ * - XML_READ_ERROR may be thrown if fails to read xml for any reason.
+ */
+void ComicFile::loadComicInfo(const QByteArray &xml_buf) {
+	QXmlStreamReader reader(xml_buf);
+
 	// Loop through xml getting values for metadata
 	while(!reader.atEnd()) {
 		reader.readNextStartElement();
@@ -797,11 +1013,10 @@ void ComicFile::loadComicInfo() {
 			throw eComics::Exception(eComics::XML_READ_ERROR, "ComicFile::populateComicInfo()",
 					getPath(), &reader);
 		}
-		QString cur_name = reader.name().toString();
 		// If ComicInfo object has metadata with name, set it's content
-		if(!info[cur_name].isNull()) {
-			QString cur_text = reader.readElementText();
-			info[cur_name].setValue(cur_text);
+		int tag_index = ComicInfo::indexOf(reader.name());
+		if(tag_index != -1) {
+			info.setValue(tag_index, reader.readElementText());
 		}
 
 		// Check if PageList
@@ -814,51 +1029,16 @@ void ComicFile::loadComicInfo() {
 				// Even though <Page/> is a single self closing element, it will still
 				// Recognize a closing </Page>, so we have to skip it
 				if(!reader.isEndElement()) {
-					QXmlStreamAttributes attributes = reader.attributes();
-					Page page;
-
-					// Loop through page attributes
-					for(int i = 0; i < attributes.size(); i++) {
-						QString attrib_name		=	attributes[i].name().toString();
-						QString attrib_value	=	attributes[i].value().toString();
-
-						if(attrib_name == "Image") {
-							page.setImage(attrib_value);
-						}
-
-						if(attrib_name == "Type") {
-							page.setType(attrib_value);
-						}
-
-						if(attrib_name == "DoublePage") {
-							page.setDoublePage(attrib_value);
-						}
-
-						if(attrib_name == "ImageSize") {
-							page.setImageSize(attrib_value);
-						}
-
-						if(attrib_name == "Key") {
-							page.setKey(attrib_value);
-						}
-
-						if(attrib_name == "ImageWidth") {
-							page.setImageWidth(attrib_value);
-						}
-
-						if(attrib_name == "ImageHeight") {
-							page.setImageHeight(attrib_value);
-						}
-					}
+					Page page = Page::fromXml(reader.attributes());
 
 					// Validate Image tag
-					if(page.getImage() != QString::number(page_num)) {
-						page = Page(QString::number(page_num));
+					if(page.getImage() != page_num) {
+						page = Page(page_num);
 						dirty = true;
 						qDebug() << "Corrected Page Image" << page_num;
 					}
 
-					info.page_list << page; // Append page to page list
+					info.editPageList() << page; // Append page to page list
 					page_num++;
 				}
 
@@ -996,9 +1176,10 @@ void ComicFile::parseFilenameForInfo() {
 
 	// Try to get pages info
 	try {
-		info.page_list.clear();
+		PageList &page_list = info.editPageList();
+		page_list.clear();
 		for(int i = 0; i < getNumOfPages(); i++) {
-			info.page_list << Page(QString::number(i));
+			page_list << Page(i);
 		}
 	} catch(const eComics::Exception &e) { e.printMsg(); }
 
@@ -1013,6 +1194,10 @@ void ComicFile::parseFilenameForInfo() {
 }
 
 
+/**
+ * Points ComicFile at path, path must be the same file after being moved or renamed, so archive
+ * isn't listed again.
+ */
 void ComicFile::setFileName(const QString &path) {
 	if(!QFile::exists(path)) {
 		qDebug() << "ComicFile::setFileName() error:" << path << "doesn't exist.";
@@ -1020,43 +1205,28 @@ void ComicFile::setFileName(const QString &path) {
 	}
 
 	QFile::setFileName(path);
+	if(in_library) library->invalidateIndex();
 
-	if(archive != nullptr) {
-		delete archive;
-		archive = new Archive(path);
+	// Archive may be shared with other copies, so point a copy of it at path instead
+	if(!archive.isNull()) {
+		Archive *moved_archive = new Archive(*archive);
+		moved_archive->setPath(path);
+		archive = QSharedPointer<const Archive>(moved_archive);
 	}
 
-	if(pdf != nullptr) {
-		delete pdf;
-		pdf = new Pdf(path);
-	}
+	if(!pdf.isNull()) pdf = QSharedPointer<const Pdf>(new Pdf(path));
 }
 
 
 /**
- * Make sure thumbnail is named properly (if ComicInfo changed), and it's the proper image (if page
- * data is changed, reordered, cover changed, etc).
+ * Make sure thumbnail exists, cover_hash is cleared wherever the cover may have changed (pages
+ * changed, or a different page made the cover), so a missing cover hash means the thumbnail has to
+ * be generated again. It's only queued to be generated in the background, at low priority,
+ * LibraryView raises it once the comic is shown.
  */
 void ComicFile::verifyThumb() {
-	// Check if comic info has been changed, and rename thumbnail accordingly
-	if(!original_info.isNull() && getThumbPath(original_info) != getThumbPath() &&
-			QFile::exists(getThumbPath(original_info))) {
-		QFile::rename(getThumbPath(original_info), getThumbPath());
-	}
-
-	// Check if pages have been reordered, or if Cover was changed to a different page
-	//TODO: CHECK IF PAGES HAVE BEEN CHANGED, IF NECESSARY DELETE OLD THUMB AND CREATE NEW ONE
-
-	// Check if thumbnail even exists, if not create it
-	if(!QFile::exists(getThumbPath())) {
-		// Try to Extract thumbnail to THUMBDIR/SERIES-VOLUME-NUMBER-TITLE.jpg
-		try{
-			extractPage(
-				info.page_list.getFrontCover(),
-				config->getThumbDir().absolutePath(),
-				getThumbName(), 512
-			);
-		} catch(const eComics::Exception &e) { e.printMsg(); }
+	if(cover_hash.isEmpty() || !hasThumb()) {
+		thumbnail_service->request(*this, ThumbnailService::LOW_PRIORITY);
 	}
 }
 
@@ -1067,26 +1237,65 @@ void ComicFile::onAddedToLibrary() {
 }
 
 
-void ComicFile::onInfoChanged(const MetadataTag &tag, const QString old_value) {
+/**
+ * Handles every tag changed in one edit at once, so the file and library are written once no matter
+ * how many tags changed. Which tags changed doesn't matter, the whole ComicInfo is written either
+ * way, and thumbnail is keyed by cover, so tag changes never affect it.
+ */
+void ComicFile::onInfoChanged(const ComicInfo::ChangeSet &) {
 	if(!editing) {
-		// Populate original_info with values, including old_value
-		original_info[tag.getName()].setValue(old_value);
-		for(int i = 0; i < info.size(); i++) {
-			if(info[i].getName() != tag.getName()) {
-				original_info[i].setValue(info[i].getValue());
-			}
-		}
-
-		// Verify thumb in case it needs to be updated
-		verifyThumb();
-
-		// Clear original_info
-		original_info.clear();
-
 		// Save info to file and library
-		save();
+		try { save(); } catch(const eComics::Exception &e) { e.printMsg(); }
 		if(in_library) library->save();
 	} else {
 		dirty = true;
 	}
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *								COMICFILE PAGESOURCE METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Returns encoded image of page with index, exactly as stored in archive (pdf pages are rendered to
+ * jpeg).
+ *
+ * Possible Exceptions:
+ * - LOGIC_ERROR may be thrown if comic is an unsupported type, or if page at index doesn't exist.
+ * - FILE_ERROR may be thrown if saving extracted pdf page to file fails, or if creating or reading
+ * the temp image file fails.
+ * - PROCESS_ERROR may be thrown if shell command for Archive fails in any way.
+ */
+QByteArray ComicFile::PageSource::readPage(const int index) const {
+	QString temp_image_path;
+
+	// Extract to a dir of our own, so pages extracted at the same time can't overwrite each other,
+	// it's removed along with the page when it goes out of scope
+	QTemporaryDir temp_dir(config->getTempPath() + "/page-XXXXXX");
+	if(!temp_dir.isValid()) {
+		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::PageSource::readPage()",
+				QString("Failed to create temp dir in ") + config->getTempPath());
+	}
+
+	// Only the backend for comic's type is set
+	if(!archive.isNull()) {
+		// This may throw a LOGIC_ERROR() or PROCESS_ERROR()
+		temp_image_path = archive->extractPage(index, temp_dir.path());
+	} else if(!pdf.isNull()) {
+		// This may throw a few exceptions
+		temp_image_path = pdf->extractPage(index, temp_dir.path());
+	} else {
+		throw eComics::Exception(eComics::LOGIC_ERROR, "ComicFile::PageSource::readPage()",
+				path + " is an unsupported type");
+	}
+
+	QFile image_file(temp_image_path);
+	if(!image_file.open(QIODevice::ReadOnly)) {
+		throw eComics::Exception(eComics::FILE_ERROR, "ComicFile::PageSource::readPage()",
+				QString("Failed to open ") + temp_image_path);
+	}
+
+	return image_file.readAll();
 }
\ No newline at end of file
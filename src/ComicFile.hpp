@@ -22,11 +22,13 @@
 
 
 #include <QFile>
+#include <QSharedPointer>
 
 #include "Exceptions.hpp"
 #include "ComicInfo.hpp"
 #include "Archive.hpp"
 #include "Config.hpp"
+#include "FileStat.hpp"
 #include "MetadataTag.hpp"
 #include "Pdf.hpp"
 
@@ -42,16 +44,40 @@ class QByteArray;
 class ComicFile : public QFile {
 	Q_OBJECT
 
+	friend class Library;
+
 	public:
+		/**
+		 * What readPage() needs, without the comic's QObjects, so pages can still be read on
+		 * another thread after the comic is gone. Backend is shared with the comic.
+		 */
+		struct PageSource {
+			QString path;
+			QSharedPointer<const Archive> archive;
+			QSharedPointer<const Pdf> pdf;
+
+			QByteArray readPage(const int index) const;
+		};
+
 		ComicInfo info;
 
 		ComicFile();
 		ComicFile(const ComicFile &comic);
-		ComicFile(const QString &path, const ComicInfo &info, const QByteArray &md5_hash);
+		ComicFile(ComicFile &&comic);
+		ComicFile(const QString &path, const ComicInfo &info, const QByteArray &md5_hash,
+				const FileStat &file_stat = FileStat(), const QByteArray &content_hash = QByteArray(),
+				const QByteArray &xml_hash = QByteArray(),
+				const QByteArray &cover_hash = QByteArray());
 		ComicFile(const QString &_path);
+		ComicFile(const QString &path, const QByteArray &md5_hash, const FileStat &file_stat);
 		~ComicFile();
+		static bool isSupportedType(const QString &path);
+		static QByteArray generateMd5Hash(const QString &path);
+		static QImage decodeImage(const QByteArray &data, const int size = 0);
 		void extractPage(const int image, const QString &path, const QString &file_name,
 				const int size = 0) const;
+		QByteArray readPage(const int index) const;
+		PageSource getPageSource() const;
 		QString getExtString() const;
 		QString getSizeString();
 		QString getNumOfPagesString() const;
@@ -60,15 +86,22 @@ class ComicFile : public QFile {
 		int getNumOfPages() const;
 		QString getFileName() const;
 		QString getPath() const;
-		QString getThumbName(const ComicInfo &comic_info = 0) const;
-		QString getThumbPath(const ComicInfo &comic_info = 0) const;
+		QImage getThumb(const int size) const;
+		bool hasThumb() const;
 		QByteArray getMd5Hash() const;
+		FileStat getFileStat() const;
+		QByteArray getContentHash() const;
+		QByteArray getXmlHash() const;
+		QByteArray getCoverHash() const;
 		bool isNull() const;
 		void move();
+		void setPath(const QString &path);
 		void save();
 		void startEditing();
 		void finishEditing();
+		void verifyThumb();
 		ComicFile & operator =(const ComicFile &comic);
+		ComicFile & operator =(ComicFile &&comic);
 		bool operator ==(const ComicFile &comic);
 
 	signals:
@@ -84,29 +117,36 @@ class ComicFile : public QFile {
 
 		ComicInfo original_info; // Used to keep track of when info is changed
 		QByteArray md5_hash;
+		FileStat file_stat; // Stat of file when md5_hash was generated, or when metadata was written
+		QByteArray content_hash; // Fingerprint of pages only, unchanged by metadata edits
+		QByteArray xml_hash; // Md5 hash of ComicInfo xml in file, saves that match it are skipped
+		QByteArray cover_hash; // Md5 hash of cover image, thumbnail is keyed by it
 		QString ext;
 		QString ns_uri; // Namespace when type is TYPE_PDF, stays blank when TYPE_ARCHIVE
-		Archive *archive	=	nullptr; // Object for managing TYPE_ARCHIVE (zip, 7z, rar)
-		Pdf *pdf			=	nullptr; // Object for managing TYPE_PDF
+		// Backends are shared between copies, they're never changed once constructed
+		QSharedPointer<const Archive> archive; // Object for managing TYPE_ARCHIVE (zip, 7z, rar)
+		QSharedPointer<const Pdf> pdf; // Object for managing TYPE_PDF
 		bool dirty			=	false;
 		bool editing		=	false;
-		bool in_library;
+		bool in_library		=	false;
 
+		QByteArray findCoverHash() const;
 		void connectSignals();
-		QString getXmlBuf() const;
+		QByteArray getXmlBuf() const;
 		void populateComicInfo();
+		bool reloadComicInfo(const ComicInfo &old_info);
 		void parseAttributeLists();
-		void loadComicInfo();
+		void loadComicInfo(const QByteArray &xml_buf);
 		bool hasComicInfo() const; // Checks for embedded ComicInfo xml
 		void parseFilenameForInfo();
 		void processError(QProcess::ProcessError error);
 		void initMd5Hash();
+		void initContentHash();
 		bool initFileType();
 		void setFileName(const QString &path);
-		void verifyThumb();
 
 	private slots:
-		void onInfoChanged(const MetadataTag &tag, const QString old_value);
+		void onInfoChanged(const ComicInfo::ChangeSet &change_set);
 		void onAddedToLibrary();
 };
 
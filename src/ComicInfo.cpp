@@ -1,8 +1,104 @@
 #include "ComicInfo.hpp"
 
+#include <cstring>
 #include <QDebug>
+#include <QMetaMethod>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include "ComicFile.hpp"
+#include "DetailsStore.hpp"
+#include "StringPool.hpp"
+
+
+// Tag names as they appear in ComicInfo.xml, in order of ComicInfo::TagType
+static const char *const tag_name_list[ComicInfo::NUM_OF_TAGS] = {
+	"Title",
+	"Series",
+	"Number",
+	"Count",
+	"Volume",
+	"AlternateSeries",
+	"AlternateNumber",
+	"AlternateCount",
+	"Summary",
+	"Notes",
+	"Year",
+	"Month",
+	"Writer",
+	"Penciller",
+	"Inker",
+	"Colorist",
+	"Letterer",
+	"CoverArtist",
+	"Editor",
+	"Publisher",
+	"Imprint",
+	"Genre",
+	"Web",
+	"PageCount",
+	"LanguageISO",
+	"Format",
+	"BlackAndWhite",
+	"Manga"
+};
+
+
+/**
+ * Perfect hash of tag names, no two tag names have the same hash, ComicInfo::indexOf() switches
+ * on it, and since duplicate case labels don't compile, adding a tag that collides is caught at
+ * compile time. Name must be at least 2 characters.
+ */
+template<class Char>
+static constexpr int tagHash(const Char *name, const int length) {
+	return (length + int(name[1]) * 13 + int(name[length - 1]) * 12) % 64;
+}
+
+template<int N>
+static constexpr int tagHash(const char (&name)[N]) {
+	return tagHash(name, N - 1);
+}
+
+
+/**
+ * Details are stored as a <Details> xml fragment, in the same form as library.xml.
+ */
+static QByteArray detailsToXml(const ComicInfo::Details &details) {
+	QByteArray record;
+	QXmlStreamWriter writer(&record);
+
+	writer.writeStartElement("Details");
+	if(!details.summary.isEmpty()) writer.writeTextElement("Summary", details.summary);
+	if(!details.notes.isEmpty()) writer.writeTextElement("Notes", details.notes);
+
+	writer.writeStartElement("Pages");
+	for(const Page &page : details.page_list) page.writeXml(writer);
+	writer.writeEndElement(); // </Pages>
+
+	writer.writeEndElement(); // </Details>
+	return record;
+}
+
+
+static void detailsFromXml(const QByteArray &record, ComicInfo::Details &details) {
+	QXmlStreamReader reader(record);
+	if(!reader.readNextStartElement() || reader.name() != "Details") return;
+
+	while(reader.readNextStartElement()) {
+		if(reader.name() == "Summary") {
+			details.summary = reader.readElementText();
+		} else if(reader.name() == "Notes") {
+			details.notes = reader.readElementText();
+		} else if(reader.name() == "Pages") {
+			while(reader.readNextStartElement()) {
+				if(reader.name() == "Page") details.page_list << Page::fromXml(reader.attributes());
+				reader.skipCurrentElement();
+			}
+		} else reader.skipCurrentElement();
+	}
+
+	if(reader.hasError()) qDebug() << "Failed to read details:" << reader.errorString();
+}
 
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -14,114 +110,259 @@
  * Instantiate a new blank ComicInfo object
  */
 ComicInfo::ComicInfo(QObject *parent) : QObject(parent) {
-	title			=	MetadataTag("Title", this);
-	series			=	MetadataTag("Series", this);
-	number			=	MetadataTag("Number", this);
-	count			=	MetadataTag("Count", this);
-	volume			=	MetadataTag("Volume", this);
-	alt_series		=	MetadataTag("AlternateSeries", this);
-	alt_number		=	MetadataTag("AlternateNumber", this);
-	alt_count		=	MetadataTag("AlternateCount", this);
-	summary			=	MetadataTag("Summary", this);
-	notes			=	MetadataTag("Notes", this);
-	year			=	MetadataTag("Year", this);
-	month			=	MetadataTag("Month", this);
-	writer			=	MetadataTag("Writer", this);
-	penciller		=	MetadataTag("Penciller", this);
-	inker			=	MetadataTag("Inker", this);
-	colorist		=	MetadataTag("Colorist", this);
-	letterer		=	MetadataTag("Letterer", this);
-	cover_artist	=	MetadataTag("CoverArtist", this);
-	editor			=	MetadataTag("Editor", this);
-	publisher		=	MetadataTag("Publisher", this);
-	imprint			=	MetadataTag("Imprint", this);
-	genre			=	MetadataTag("Genre", this);
-	web				=	MetadataTag("Web", this);
-	page_count		=	MetadataTag("PageCount", this);
-	language_iso	=	MetadataTag("LanguageISO", this);
-	format			=	MetadataTag("Format", this);
-	black_and_white	=	MetadataTag("BlackAndWhite", this);
-	manga			=	MetadataTag("Manga", this);
-
-	connectSignals();
+	std::memset(value_list, 0, sizeof(value_list));
 }
 
 
 ComicInfo::ComicInfo(const ComicInfo &info) : QObject() {
+	std::memset(value_list, 0, sizeof(value_list));
 	*this = info;
-	connectSignals();
+}
+
+
+ComicInfo::~ComicInfo() {
+	for(const quint32 id : value_list) StringPool::release(id);
+}
+
+
+/**
+ * Returns name of tag at index i, or a null QString if i is out of bounds.
+ */
+QString ComicInfo::getName(const int i) {
+	if(i < 0 || i >= NUM_OF_TAGS) return QString();
+	return QString(tag_name_list[i]);
+}
+
+
+/**
+ * Returns index of tag with name, or -1 if there is no such tag.
+ */
+int ComicInfo::indexOf(const QString &name) {
+	return indexOf(QStringRef(&name));
+}
+
+
+/**
+ * Returns index of tag with name, or -1 if there is no such tag. Takes a QStringRef so that names
+ * from QXmlStreamReader::name() can be looked up without copying them.
+ */
+int ComicInfo::indexOf(const QStringRef &name) {
+	if(name.size() < 2) return -1;
+
+	int i;
+	switch(tagHash(reinterpret_cast<const ushort *>(name.unicode()), name.size())) {
+		case tagHash("Title"): i = TITLE_TAG; break;
+		case tagHash("Series"): i = SERIES_TAG; break;
+		case tagHash("Number"): i = NUMBER_TAG; break;
+		case tagHash("Count"): i = COUNT_TAG; break;
+		case tagHash("Volume"): i = VOLUME_TAG; break;
+		case tagHash("AlternateSeries"): i = ALT_SERIES_TAG; break;
+		case tagHash("AlternateNumber"): i = ALT_NUMBER_TAG; break;
+		case tagHash("AlternateCount"): i = ALT_COUNT_TAG; break;
+		case tagHash("Summary"): i = SUMMARY_TAG; break;
+		case tagHash("Notes"): i = NOTES_TAG; break;
+		case tagHash("Year"): i = YEAR_TAG; break;
+		case tagHash("Month"): i = MONTH_TAG; break;
+		case tagHash("Writer"): i = WRITER_TAG; break;
+		case tagHash("Penciller"): i = PENCILLER_TAG; break;
+		case tagHash("Inker"): i = INKER_TAG; break;
+		case tagHash("Colorist"): i = COLORIST_TAG; break;
+		case tagHash("Letterer"): i = LETTERER_TAG; break;
+		case tagHash("CoverArtist"): i = COVER_ARTIST_TAG; break;
+		case tagHash("Editor"): i = EDITOR_TAG; break;
+		case tagHash("Publisher"): i = PUBLISHER_TAG; break;
+		case tagHash("Imprint"): i = IMPRINT_TAG; break;
+		case tagHash("Genre"): i = GENRE_TAG; break;
+		case tagHash("Web"): i = WEB_TAG; break;
+		case tagHash("PageCount"): i = PAGE_COUNT_TAG; break;
+		case tagHash("LanguageISO"): i = LANGUAGE_ISO_TAG; break;
+		case tagHash("Format"): i = FORMAT_TAG; break;
+		case tagHash("BlackAndWhite"): i = BLACK_AND_WHITE_TAG; break;
+		case tagHash("Manga"): i = MANGA_TAG; break;
+		default: return -1;
+	}
+
+	// Names that aren't tags can still have the same hash as one, so compare once
+	return (name == QLatin1String(tag_name_list[i])) ? i : -1;
+}
+
+
+/**
+ * Returns true if tag at index i is part of Details, rather than always resident.
+ */
+bool ComicInfo::isDetailsTag(const int i) {
+	return (i == SUMMARY_TAG || i == NOTES_TAG);
 }
 
 
 void ComicInfo::clear() {
-	for(int i = 0; i < size(); i++) (*this)[i].setValue("");
+	for(int i = 0; i < size(); i++) setValue(i, "");
+}
+
+
+/**
+ * Returns page list, loading details if they aren't loaded yet.
+ */
+const PageList & ComicInfo::getPageList() const {
+	return getDetails().page_list;
+}
+
+
+/**
+ * Returns page list for editing, loading details if they aren't loaded yet, and copying them first
+ * if they're shared with another ComicInfo.
+ */
+PageList & ComicInfo::editPageList() {
+	return editDetails().page_list;
+}
+
+
+bool ComicInfo::isDetailsLoaded() const {
+	return details.constData() != nullptr;
+}
+
+
+/**
+ * Sets id of details in DetailsStore, so they can be loaded when first used, details that are
+ * already loaded are dropped.
+ */
+void ComicInfo::setDetailsId(const quint32 id) {
+	details_id = id;
+	details.reset();
+}
+
+
+/**
+ * Writes details to DetailsStore while it's being rewritten, if they were never loaded then they're
+ * just copied as is. Returns id of details in store.
+ */
+quint32 ComicInfo::saveDetails() {
+	if(isDetailsLoaded()) details_id = DetailsStore::write(details_id, detailsToXml(*details));
+	else details_id = DetailsStore::copy(details_id);
+
+	return details_id;
+}
+
+
+/**
+ * Returns value of tag at index i, i must be in bounds.
+ */
+QString ComicInfo::getValue(const int i) const {
+	switch(i) {
+		case SUMMARY_TAG:
+			return getDetails().summary;
+
+		case NOTES_TAG:
+			return getDetails().notes;
+
+		default:
+			return StringPool::get(value_list[i]);
+	}
+}
+
+
+/**
+ * Sets value of tag at index i, i must be in bounds. If anything is connected to changed() then the
+ * change is added to the pending ChangeSet, which is delivered on the next turn of the event loop.
+ */
+void ComicInfo::setValue(const int i, const QString &value) {
+	QString old_value = getValue(i);
+
+	// Details tags aren't interned, they're long and rarely shared
+	if(isDetailsTag(i)) {
+		if(old_value == value) return;
+		if(i == SUMMARY_TAG) editDetails().summary = value;
+		else editDetails().notes = value;
+	} else {
+		quint32 id = StringPool::intern(value);
+		StringPool::release(value_list[i]);
+		if(id == value_list[i]) return;
+		value_list[i] = id;
+	}
+
+	if(!isSignalConnected(QMetaMethod::fromSignal(&ComicInfo::changed))) return;
+
+	auto iter = pending_changes.find(i);
+	if(iter == pending_changes.end()) {
+		pending_changes.insert(i, TagChange( {old_value, value} ));
+	} else if(iter->old_value == value) {
+		// Changed back, so it's not a change anymore
+		pending_changes.erase(iter);
+	} else {
+		iter->new_value = value;
+	}
+
+	if(!flush_pending) {
+		flush_pending = true;
+		QMetaObject::invokeMethod(this, "flushChanges", Qt::QueuedConnection);
+	}
 }
 
 
 /**
  * Getters for all MetadataTags.
  */
-QString ComicInfo::getTitle() const { return title.getValue(); }
-QString ComicInfo::getSeries() const { return series.getValue(); }
-QString ComicInfo::getNumber() const { return number.getValue(); }
-QString ComicInfo::getCount() const { return count.getValue(); }
-QString ComicInfo::getVolume() const { return volume.getValue(); }
-QString ComicInfo::getAltSeries() const { return alt_series.getValue(); }
-QString ComicInfo::getAltNumber() const { return alt_number.getValue(); }
-QString ComicInfo::getAltCount() const { return alt_count.getValue(); }
-QString ComicInfo::getSummary() const { return summary.getValue(); }
-QString ComicInfo::getNotes() const { return notes.getValue(); }
-QString ComicInfo::getYear() const { return year.getValue(); }
-QString ComicInfo::getMonth() const { return month.getValue(); }
-QString ComicInfo::getWriter() const { return writer.getValue(); }
-QString ComicInfo::getPenciller() const { return penciller.getValue(); }
-QString ComicInfo::getInker() const { return inker.getValue(); }
-QString ComicInfo::getColorist() const { return colorist.getValue(); }
-QString ComicInfo::getLetterer() const { return letterer.getValue(); }
-QString ComicInfo::getCoverArtist() const { return cover_artist.getValue(); }
-QString ComicInfo::getEditor() const { return editor.getValue(); }
-QString ComicInfo::getPublisher() const { return publisher.getValue(); }
-QString ComicInfo::getImprint() const { return imprint.getValue(); }
-QString ComicInfo::getGenre() const { return genre.getValue(); }
-QString ComicInfo::getWeb() const { return web.getValue(); }
-QString ComicInfo::getPageCount() const { return page_count.getValue(); }
-QString ComicInfo::getLanguageIso() const { return language_iso.getValue(); }
-QString ComicInfo::getFormat() const { return format.getValue(); }
-QString ComicInfo::getBlackAndWhite() const { return black_and_white.getValue(); }
-QString ComicInfo::getManga() const { return manga.getValue(); }
+QString ComicInfo::getTitle() const { return getValue(TITLE_TAG); }
+QString ComicInfo::getSeries() const { return getValue(SERIES_TAG); }
+QString ComicInfo::getNumber() const { return getValue(NUMBER_TAG); }
+QString ComicInfo::getCount() const { return getValue(COUNT_TAG); }
+QString ComicInfo::getVolume() const { return getValue(VOLUME_TAG); }
+QString ComicInfo::getAltSeries() const { return getValue(ALT_SERIES_TAG); }
+QString ComicInfo::getAltNumber() const { return getValue(ALT_NUMBER_TAG); }
+QString ComicInfo::getAltCount() const { return getValue(ALT_COUNT_TAG); }
+QString ComicInfo::getSummary() const { return getValue(SUMMARY_TAG); }
+QString ComicInfo::getNotes() const { return getValue(NOTES_TAG); }
+QString ComicInfo::getYear() const { return getValue(YEAR_TAG); }
+QString ComicInfo::getMonth() const { return getValue(MONTH_TAG); }
+QString ComicInfo::getWriter() const { return getValue(WRITER_TAG); }
+QString ComicInfo::getPenciller() const { return getValue(PENCILLER_TAG); }
+QString ComicInfo::getInker() const { return getValue(INKER_TAG); }
+QString ComicInfo::getColorist() const { return getValue(COLORIST_TAG); }
+QString ComicInfo::getLetterer() const { return getValue(LETTERER_TAG); }
+QString ComicInfo::getCoverArtist() const { return getValue(COVER_ARTIST_TAG); }
+QString ComicInfo::getEditor() const { return getValue(EDITOR_TAG); }
+QString ComicInfo::getPublisher() const { return getValue(PUBLISHER_TAG); }
+QString ComicInfo::getImprint() const { return getValue(IMPRINT_TAG); }
+QString ComicInfo::getGenre() const { return getValue(GENRE_TAG); }
+QString ComicInfo::getWeb() const { return getValue(WEB_TAG); }
+QString ComicInfo::getPageCount() const { return getValue(PAGE_COUNT_TAG); }
+QString ComicInfo::getLanguageIso() const { return getValue(LANGUAGE_ISO_TAG); }
+QString ComicInfo::getFormat() const { return getValue(FORMAT_TAG); }
+QString ComicInfo::getBlackAndWhite() const { return getValue(BLACK_AND_WHITE_TAG); }
+QString ComicInfo::getManga() const { return getValue(MANGA_TAG); }
 
 
 /**
  * Setters for all MetadataTags.
  */
-void ComicInfo::setTitle(const QString &value) { title.setValue(value); }
-void ComicInfo::setSeries(const QString &value) { series.setValue(value); }
-void ComicInfo::setNumber(const QString &value) { number.setValue(value); }
-void ComicInfo::setCount(const QString &value) { count.setValue(value); }
-void ComicInfo::setVolume(const QString &value) { volume.setValue(value); }
-void ComicInfo::setAltSeries(const QString &value) { alt_series.setValue(value); }
-void ComicInfo::setAltNumber(const QString &value) { alt_number.setValue(value); }
-void ComicInfo::setAltCount(const QString &value) { alt_count.setValue(value); }
-void ComicInfo::setSummary(const QString &value) { summary.setValue(value); }
-void ComicInfo::setNotes(const QString &value) { notes.setValue(value); }
-void ComicInfo::setYear(const QString &value) { year.setValue(value); }
-void ComicInfo::setMonth(const QString &value) { month.setValue(value); }
-void ComicInfo::setWriter(const QString &value) { writer.setValue(value); }
-void ComicInfo::setPenciller(const QString &value) { penciller.setValue(value); }
-void ComicInfo::setInker(const QString &value) { inker.setValue(value); }
-void ComicInfo::setColorist(const QString &value) { colorist.setValue(value); }
-void ComicInfo::setLetterer(const QString &value) { letterer.setValue(value); }
-void ComicInfo::setCoverArtist(const QString &value) { cover_artist.setValue(value); }
-void ComicInfo::setEditor(const QString &value) { editor.setValue(value); }
-void ComicInfo::setPublisher(const QString &value) { publisher.setValue(value); }
-void ComicInfo::setImprint(const QString &value) { imprint.setValue(value); }
-void ComicInfo::setGenre(const QString &value) { genre.setValue(value); }
-void ComicInfo::setWeb(const QString &value) { web.setValue(value); }
-void ComicInfo::setPageCount(const QString &value) { page_count.setValue(value); }
-void ComicInfo::setLanguageIso(const QString &value) { language_iso.setValue(value); }
-void ComicInfo::setFormat(const QString &value) { format.setValue(value); }
-void ComicInfo::setBlackAndWhite(const QString &value) { black_and_white.setValue(value); }
-void ComicInfo::setManga(const QString &value) { manga.setValue(value); }
+void ComicInfo::setTitle(const QString &value) { setValue(TITLE_TAG, value); }
+void ComicInfo::setSeries(const QString &value) { setValue(SERIES_TAG, value); }
+void ComicInfo::setNumber(const QString &value) { setValue(NUMBER_TAG, value); }
+void ComicInfo::setCount(const QString &value) { setValue(COUNT_TAG, value); }
+void ComicInfo::setVolume(const QString &value) { setValue(VOLUME_TAG, value); }
+void ComicInfo::setAltSeries(const QString &value) { setValue(ALT_SERIES_TAG, value); }
+void ComicInfo::setAltNumber(const QString &value) { setValue(ALT_NUMBER_TAG, value); }
+void ComicInfo::setAltCount(const QString &value) { setValue(ALT_COUNT_TAG, value); }
+void ComicInfo::setSummary(const QString &value) { setValue(SUMMARY_TAG, value); }
+void ComicInfo::setNotes(const QString &value) { setValue(NOTES_TAG, value); }
+void ComicInfo::setYear(const QString &value) { setValue(YEAR_TAG, value); }
+void ComicInfo::setMonth(const QString &value) { setValue(MONTH_TAG, value); }
+void ComicInfo::setWriter(const QString &value) { setValue(WRITER_TAG, value); }
+void ComicInfo::setPenciller(const QString &value) { setValue(PENCILLER_TAG, value); }
+void ComicInfo::setInker(const QString &value) { setValue(INKER_TAG, value); }
+void ComicInfo::setColorist(const QString &value) { setValue(COLORIST_TAG, value); }
+void ComicInfo::setLetterer(const QString &value) { setValue(LETTERER_TAG, value); }
+void ComicInfo::setCoverArtist(const QString &value) { setValue(COVER_ARTIST_TAG, value); }
+void ComicInfo::setEditor(const QString &value) { setValue(EDITOR_TAG, value); }
+void ComicInfo::setPublisher(const QString &value) { setValue(PUBLISHER_TAG, value); }
+void ComicInfo::setImprint(const QString &value) { setValue(IMPRINT_TAG, value); }
+void ComicInfo::setGenre(const QString &value) { setValue(GENRE_TAG, value); }
+void ComicInfo::setWeb(const QString &value) { setValue(WEB_TAG, value); }
+void ComicInfo::setPageCount(const QString &value) { setValue(PAGE_COUNT_TAG, value); }
+void ComicInfo::setLanguageIso(const QString &value) { setValue(LANGUAGE_ISO_TAG, value); }
+void ComicInfo::setFormat(const QString &value) { setValue(FORMAT_TAG, value); }
+void ComicInfo::setBlackAndWhite(const QString &value) { setValue(BLACK_AND_WHITE_TAG, value); }
+void ComicInfo::setManga(const QString &value) { setValue(MANGA_TAG, value); }
 
 
 /**
@@ -129,10 +370,11 @@ void ComicInfo::setManga(const QString &value) { manga.setValue(value); }
  */
 bool ComicInfo::isNull() const {
 	for(int i = 0; i < size(); i++) {
-		if(!this->at(i).getValue().isEmpty()) return false;
+		if(value_list[i] != 0) return false;
 	}
 
-	return true;
+	// Details are only loaded when every other tag is empty
+	return getDetails().summary.isEmpty() && getDetails().notes.isEmpty();
 }
 
 
@@ -140,162 +382,57 @@ bool ComicInfo::isNull() const {
  * Returns number of metadata items.
  */
 int ComicInfo::size() const {
-	return 28;
+	return NUM_OF_TAGS;
 }
 
 
 /**
- * Returns const reference to MetadataTag at index i, returns null when index is out of bounds,
- * null.isNull() will return true. Can not be used to get path or page_list members. If returned
- * MetadataTag needs to be editable, then use operator [].
+ * Returns MetadataTag at index i, returns null when index is out of bounds, null.isNull() will
+ * return true. Can not be used to get path or page_list members. Returned MetadataTag is const
+ * since this is, if it needs to be editable, then use operator [].
  */
-const MetadataTag& ComicInfo::at(const int i) const {
-	switch(i) {
-		case 0: return title;
-		case 1: return series;
-		case 2: return number;
-		case 3: return count;
-		case 4: return volume;
-		case 5: return alt_series;
-		case 6: return alt_number;
-		case 7: return alt_count;
-		case 8: return summary;
-		case 9: return notes;
-		case 10: return year;
-		case 11: return month;
-		case 12: return writer;
-		case 13: return penciller;
-		case 14: return inker;
-		case 15: return colorist;
-		case 16: return letterer;
-		case 17: return cover_artist;
-		case 18: return editor;
-		case 19: return publisher;
-		case 20: return imprint;
-		case 21: return genre;
-		case 22: return web;
-		case 23: return page_count;
-		case 24: return language_iso;
-		case 25: return format;
-		case 26: return black_and_white;
-		case 27: return manga;
-		default: return null;
-	}
+const MetadataTag ComicInfo::at(const int i) const {
+	return MetadataTag(const_cast<ComicInfo *>(this), i);
 }
 
 
 /**
- * Returns const reference to MetadataTag with name, returns null if name is not found,
- * null.isNull() will return true. Can not be used to get path or page_list members.
+ * Returns MetadataTag with name, returns null if name is not found, null.isNull() will return
+ * true. Can not be used to get path or page_list members.
  */
-const MetadataTag& ComicInfo::at(const QString &name) const {
-	return
-		(name == "Title") ? title :
-		(name == "Series") ? series :
-		(name == "Number") ? number :
-		(name == "Count") ? count :
-		(name == "Volume") ? volume :
-		(name == "AlternateSeries") ? alt_series :
-		(name == "AlternateNumber") ? alt_number :
-		(name == "AlternateCount") ? alt_count :
-		(name == "Summary") ? summary :
-		(name == "Notes") ? notes :
-		(name == "Year") ? year :
-		(name == "Month") ? month :
-		(name == "Writer") ? writer :
-		(name == "Penciller") ? penciller :
-		(name == "Inker") ? inker :
-		(name == "Colorist") ? colorist :
-		(name == "Letter") ? letterer :
-		(name == "CoverArtist") ? cover_artist :
-		(name == "Editor") ? editor :
-		(name == "Publisher") ? publisher :
-		(name == "Imprint") ? imprint :
-		(name == "Genre") ? genre :
-		(name == "Web") ? web :
-		(name == "PageCount") ? page_count :
-		(name == "LanguageISO") ? language_iso :
-		(name == "Format") ? format :
-		(name == "BlackAndWhite") ? black_and_white :
-		(name == "Manga") ? manga :
-		null;
+const MetadataTag ComicInfo::at(const QString &name) const {
+	return at(indexOf(name));
 }
 
 
 /**
- * Returns reference to MetadataTag at index i, returns null when index is out of bounds,
- * null.isNull() will return true. Can not be used to get path or page_list members.
+ * Returns MetadataTag at index i, returns null when index is out of bounds, null.isNull() will
+ * return true. Can not be used to get path or page_list members.
  */
-MetadataTag& ComicInfo::operator [](const int i) {
-	switch(i) {
-		case 0: return title;
-		case 1: return series;
-		case 2: return number;
-		case 3: return count;
-		case 4: return volume;
-		case 5: return alt_series;
-		case 6: return alt_number;
-		case 7: return alt_count;
-		case 8: return summary;
-		case 9: return notes;
-		case 10: return year;
-		case 11: return month;
-		case 12: return writer;
-		case 13: return penciller;
-		case 14: return inker;
-		case 15: return colorist;
-		case 16: return letterer;
-		case 17: return cover_artist;
-		case 18: return editor;
-		case 19: return publisher;
-		case 20: return imprint;
-		case 21: return genre;
-		case 22: return web;
-		case 23: return page_count;
-		case 24: return language_iso;
-		case 25: return format;
-		case 26: return black_and_white;
-		case 27: return manga;
-		default: return null;
-	}
+MetadataTag ComicInfo::operator [](const int i) {
+	return MetadataTag(this, i);
 }
 
 
 /**
- * Returns reference to MetadataTag with name, returns null if name is not found,
- * null.isNull() will return true. Can not be used to get path or page_list members.
+ * Returns MetadataTag with name, returns null if name is not found, null.isNull() will return
+ * true. Can not be used to get path or page_list members.
  */
-MetadataTag& ComicInfo::operator [](const QString &name) {
-	return
-		(name == "Title") ? title :
-		(name == "Series") ? series :
-		(name == "Number") ? number :
-		(name == "Count") ? count :
-		(name == "Volume") ? volume :
-		(name == "AlternateSeries") ? alt_series :
-		(name == "AlternateNumber") ? alt_number :
-		(name == "AlternateCount") ? alt_count :
-		(name == "Summary") ? summary :
-		(name == "Notes") ? notes :
-		(name == "Year") ? year :
-		(name == "Month") ? month :
-		(name == "Writer") ? writer :
-		(name == "Penciller") ? penciller :
-		(name == "Inker") ? inker :
-		(name == "Colorist") ? colorist :
-		(name == "Letter") ? letterer :
-		(name == "CoverArtist") ? cover_artist :
-		(name == "Editor") ? editor :
-		(name == "Publisher") ? publisher :
-		(name == "Imprint") ? imprint :
-		(name == "Genre") ? genre :
-		(name == "Web") ? web :
-		(name == "PageCount") ? page_count :
-		(name == "LanguageISO") ? language_iso :
-		(name == "Format") ? format :
-		(name == "BlackAndWhite") ? black_and_white :
-		(name == "Manga") ? manga :
-		null;
+MetadataTag ComicInfo::operator [](const QString &name) {
+	return MetadataTag(this, indexOf(name));
+}
+
+
+/**
+ * Delivers pending changes now, as a single ChangeSet, does nothing if there are none.
+ */
+void ComicInfo::flushChanges() {
+	flush_pending = false;
+	if(pending_changes.isEmpty()) return;
+
+	ChangeSet change_set;
+	change_set.swap(pending_changes);
+	emit changed(change_set);
 }
 
 
@@ -303,31 +440,31 @@ MetadataTag& ComicInfo::operator [](const QString &name) {
  * Compares each value in ComicInfo objects, returns true if all match, false if not.
  */
 bool ComicInfo::operator ==(const ComicInfo &info) const {
-	// Loop through MetadataTags comparing values
-	for(int i = 0; !this->at(i).isNull(); i++) {
-		if(this->at(i).getValue() != info.at(i).getValue()) {
-			return false;
-		}
+	// Values are interned, so equal values have equal ids
+	if(std::memcmp(value_list, info.value_list, sizeof(value_list)) != 0) {
+		return false;
+	}
+
+	// Details that are shared, or still the same record in DetailsStore, must be the same
+	if(details.constData() == info.details.constData() &&
+			(isDetailsLoaded() || details_id == info.details_id)) {
+		return true;
+	}
+
+	if(getDetails().summary != info.getDetails().summary ||
+			getDetails().notes != info.getDetails().notes) {
+		return false;
 	}
 
 	// Compare number of pages
-	if(this->page_list.size() != info.page_list.size()) {
+	const PageList &page_list = getPageList();
+	if(page_list.size() != info.getPageList().size()) {
 		return false;
 	}
 
 	// Loop through pages comparing values
-	for(int i = 0; i < this->page_list.size(); i++) {
-		const Page &page_lhs = this->page_list.at(i);
-		const Page &page_rhs = info.page_list.at(i);
-		if(
-			page_lhs.getImage() != page_rhs.getImage() ||
-			page_lhs.getType() != page_rhs.getType() ||
-			page_lhs.getDoublePage() != page_rhs.getDoublePage() ||
-			page_lhs.getImageSize() != page_rhs.getImageSize() ||
-			page_lhs.getKey() != page_rhs.getKey() ||
-			page_lhs.getImageWidth() != page_rhs.getImageWidth() ||
-			page_lhs.getImageHeight() != page_rhs.getImageHeight()
-		) {
+	for(int i = 0; i < page_list.size(); i++) {
+		if(page_list.at(i) != info.getPageList().at(i)) {
 			return false;
 		}
 	}
@@ -341,13 +478,15 @@ bool ComicInfo::operator ==(const ComicInfo &info) const {
  * Copies all metadata values, but leaves parent untouched.
  */
 ComicInfo & ComicInfo::operator =(const ComicInfo &info) {
-	// First copy all MetadataTags
-	for(int i = 0; i < size(); i++) {
-		(*this)[i] = info.at(i);
-	}
+	// First copy all MetadataTags, taking references to new values before dropping old ones, in
+	// case they're the same
+	for(const quint32 id : info.value_list) StringPool::retain(id);
+	for(const quint32 id : value_list) StringPool::release(id);
+	std::memcpy(value_list, info.value_list, sizeof(value_list));
 
-	// next copy PageList
-	page_list = info.page_list;
+	// Next share Details, they're copied if either one changes them
+	details		=	info.details;
+	details_id	=	info.details_id;
 
 	return *this;
 }
@@ -358,9 +497,24 @@ ComicInfo & ComicInfo::operator =(const ComicInfo &info) {
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 
-void ComicInfo::connectSignals() {
-	for(int i = 0; i < size(); i++) {
-		connect(&(*this)[i], SIGNAL(changed(const MetadataTag &, const QString)), this,
-			SIGNAL(tagChanged(const MetadataTag &, const QString)));
+/**
+ * Returns details, loading them from DetailsStore the first time.
+ */
+const ComicInfo::Details & ComicInfo::getDetails() const {
+	if(!isDetailsLoaded()) {
+		Details *loaded = new Details;
+		if(details_id != 0) detailsFromXml(DetailsStore::read(details_id), *loaded);
+		details = loaded;
 	}
+
+	return *details.constData();
+}
+
+
+/**
+ * Returns details for editing, they're copied first if shared with another ComicInfo.
+ */
+ComicInfo::Details & ComicInfo::editDetails() {
+	getDetails();
+	return *details.data();
 }
\ No newline at end of file
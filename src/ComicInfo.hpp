@@ -28,6 +28,11 @@
 #define COMICINFO_HPP
 
 
+#include <QMap>
+#include <QObject>
+#include <QSharedData>
+#include <QSharedDataPointer>
+
 #include "MetadataTag.hpp"
 #include "Page.hpp"
 
@@ -36,16 +41,91 @@
  * ComicInfo contains MetadataTags which can be iterated through with [] operator (like any list or
  * array), and a QList of Pages. An out of bounds [index] will return a metadata tag that
  * isNull().
+ *
+ * Values are stored as StringPool ids, so a ComicInfo is one small fixed size record no matter how
+ * many tags are filled, and values shared between comics are only stored once. MetadataTags
+ * returned by at() and [] are views onto this record.
+ *
+ * Values are split in two tiers. The hot tier (every tag but Summary and Notes) is always resident,
+ * it's all that's needed to browse the library. The cold tier (Details: summary, notes, and page
+ * list) is only needed by ComicInfoDialog and the Pages tab, so comics loaded from library leave it
+ * in DetailsStore until it's first used. Copies share Details until one of them changes it.
+ *
+ * Changes are collected into a ChangeSet and delivered all at once by changed(), on the next turn
+ * of the event loop, or right away with flushChanges(), so that editing several tags is handled as
+ * one edit. Changes are only collected while something is connected to changed().
  */
 class ComicInfo : public QObject {
 	Q_OBJECT
 
 	public:
-		PageList page_list; // To avoid being overcomplex, we need direct access to page_list
+		enum TagType {
+			TITLE_TAG,
+			SERIES_TAG,
+			NUMBER_TAG,
+			COUNT_TAG,
+			VOLUME_TAG,
+			ALT_SERIES_TAG,
+			ALT_NUMBER_TAG,
+			ALT_COUNT_TAG,
+			SUMMARY_TAG,
+			NOTES_TAG,
+			YEAR_TAG,
+			MONTH_TAG,
+			WRITER_TAG,
+			PENCILLER_TAG,
+			INKER_TAG,
+			COLORIST_TAG,
+			LETTERER_TAG,
+			COVER_ARTIST_TAG,
+			EDITOR_TAG,
+			PUBLISHER_TAG,
+			IMPRINT_TAG,
+			GENRE_TAG,
+			WEB_TAG,
+			PAGE_COUNT_TAG,
+			LANGUAGE_ISO_TAG,
+			FORMAT_TAG,
+			BLACK_AND_WHITE_TAG,
+			MANGA_TAG,
+			NUM_OF_TAGS
+		};
+
+		/**
+		 * Old and new value of a changed tag, a tag changed several times in one ChangeSet has it's
+		 * first old value and last new value.
+		 */
+		struct TagChange {
+			QString old_value;
+			QString new_value;
+		};
+
+		typedef QMap<int, TagChange> ChangeSet; // Changed tags by index
+
+		/**
+		 * Cold tier, loaded from DetailsStore on first use.
+		 */
+		struct Details : public QSharedData {
+			QString summary;
+			QString notes;
+			PageList page_list;
+		};
 
 		ComicInfo(QObject *parent = 0);
 		ComicInfo(const ComicInfo &info);
+		~ComicInfo();
+		static QString getName(const int i);
+		static int indexOf(const QString &name);
+		static int indexOf(const QStringRef &name);
+		static bool isDetailsTag(const int i);
 		void clear();
+		const PageList & getPageList() const;
+		PageList & editPageList();
+		bool isDetailsLoaded() const;
+		void setDetailsId(const quint32 id);
+		quint32 saveDetails();
+		QString getValue(const int i) const;
+		void setValue(const int i, const QString &value);
 		QString getTitle() const;
 		QString getSeries() const;
 		QString getNumber() const;
@@ -104,48 +184,28 @@ class ComicInfo : public QObject {
 		void setManga(const QString &value);
 		bool isNull() const;
 		int size() const;
-		const MetadataTag& at(const int i) const;
-		const MetadataTag& at(const QString &name) const;
-		MetadataTag& operator [](const int i);
-		MetadataTag& operator [](const QString& name);
+		const MetadataTag at(const int i) const;
+		const MetadataTag at(const QString &name) const;
+		MetadataTag operator [](const int i);
+		MetadataTag operator [](const QString& name);
 		bool operator ==(const ComicInfo &info) const;
 		ComicInfo & operator =(const ComicInfo &info);
 
 	signals:
-		void tagChanged(const MetadataTag &tag, const QString &old_value);
+		void changed(const ComicInfo::ChangeSet &change_set);
+
+	public slots:
+		void flushChanges();
 
 	private:
-		MetadataTag title;
-		MetadataTag series;
-		MetadataTag number;
-		MetadataTag count;
-		MetadataTag volume;
-		MetadataTag alt_series;
-		MetadataTag alt_number;
-		MetadataTag alt_count;
-		MetadataTag summary;
-		MetadataTag notes;
-		MetadataTag year;
-		MetadataTag month;
-		MetadataTag writer;
-		MetadataTag penciller;
-		MetadataTag inker;
-		MetadataTag colorist;
-		MetadataTag letterer;
-		MetadataTag cover_artist;
-		MetadataTag editor;
-		MetadataTag publisher;
-		MetadataTag imprint;
-		MetadataTag genre;
-		MetadataTag web;
-		MetadataTag page_count;
-		MetadataTag language_iso;
-		MetadataTag format;
-		MetadataTag black_and_white;
-		MetadataTag manga;
-		MetadataTag null;
-
-		void connectSignals();
+		quint32 value_list[NUM_OF_TAGS]; // Held StringPool id of each tag's value, 0 for details
+		mutable QSharedDataPointer<Details> details; // Null until loaded
+		quint32 details_id = 0; // Id of record in DetailsStore, 0 if details were never stored
+		ChangeSet pending_changes;
+		bool flush_pending = false;
+
+		const Details & getDetails() const;
+		Details & editDetails();
 };
 
 
@@ -20,9 +20,11 @@
 #include "Config.hpp"
 #include "DelimitedCompleter.hpp"
 #include "FixedGridLayout.hpp"
+#include "ImageScaler.hpp"
 #include "Library.hpp"
 #include "LibraryView.hpp"
 #include "PageListView.hpp"
+#include "ThumbnailService.hpp"
 
 
 ComicInfoDialog *comic_info_dialog										=	nullptr;
@@ -191,7 +193,7 @@ void ComicInfoDialog::MultipleInfoPage::destroy() {
 
 void ComicInfoDialog::MultipleInfoPage::onFinished(const int result) {
 	if(result == Accepted) {
-		library->startBatchEditing();
+		library->beginTransaction();
 
 		QProgressDialog progress_dialog(tr("Saving metadata to comic files..."), 0, 0,
 		comic_info_dialog->selected_list.size(), comic_info_dialog);
@@ -315,7 +317,7 @@ void ComicInfoDialog::MultipleInfoPage::onFinished(const int result) {
 			QApplication::processEvents();
 		}
 
-		library->finishBatchEditing();
+		library->commit();
 	}
 }
 
@@ -727,7 +729,8 @@ ComicInfoDialog::PropertiesTab::PropertiesTab(QWidget *parent) : QWidget(parent)
 
 	// Cover
 	cover = new QLabel();
-	cover->setPixmap(QPixmap(comic.getThumbPath()).scaled(384, 384, Qt::KeepAspectRatio));
+	cover->setPixmap(QPixmap::fromImage(
+			ImageScaler::scaled(comic.getThumb(ThumbnailService::COVER_SIZE), 384, 384)));
 
 	// Properties
 	type_label	=	new QLabel(QString("<b>File Type:</b> ") + comic.getExtString());
@@ -0,0 +1,253 @@
+#include "DetailsStore.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "Exceptions.hpp"
+
+
+QString DetailsStore::path;
+QString DetailsStore::new_path;
+QVector<DetailsStore::Location> DetailsStore::location_list;
+QVector<DetailsStore::Location> DetailsStore::new_location_list;
+QFile *DetailsStore::old_file		=	nullptr;
+QSaveFile *DetailsStore::new_file	=	nullptr;
+QMutex DetailsStore::mutex(QMutex::Recursive); // Reading details while saving is allowed
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									DETAILSSTORE PUBLIC METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+void DetailsStore::setPath(const QString &_path) {
+	QMutexLocker locker(&mutex);
+	path = _path;
+}
+
+
+/**
+ * Returns path of store, while store is being written it's the path of the new file.
+ */
+QString DetailsStore::getPath() {
+	QMutexLocker locker(&mutex);
+	return (new_file != nullptr) ? new_path : path;
+}
+
+
+/**
+ * Deletes older generations of store, call once a library.xml naming the current one is on disk.
+ */
+void DetailsStore::removeStale() {
+	QMutexLocker locker(&mutex);
+	if(new_file != nullptr) return;
+
+	const QFileInfo info(path);
+	QDir dir = info.dir();
+	for(const QString &name : dir.entryList({info.baseName() + "*.dat"}, QDir::Files)) {
+		if(name != info.fileName() && !dir.remove(name)) {
+			qDebug() << "DetailsStore::removeStale() failed to remove" << dir.filePath(name);
+		}
+	}
+}
+
+
+/**
+ * Registers a record that's already in store at location (e.g. from library.xml), returns it's id.
+ */
+quint32 DetailsStore::add(const Location &location) {
+	QMutexLocker locker(&mutex);
+	location_list << location;
+	return location_list.size();
+}
+
+
+/**
+ * Returns record with id, or a null QByteArray if it doesn't exist or can't be read.
+ */
+QByteArray DetailsStore::read(const quint32 id) {
+	QMutexLocker locker(&mutex);
+
+	// While store is being rewritten, records are still read from the old file
+	if(old_file != nullptr) return readLocked(id, *old_file);
+
+	QFile file(path);
+	if(!file.open(QIODevice::ReadOnly)) {
+		qDebug() << "DetailsStore::read() failed to open" << path;
+		return QByteArray();
+	}
+
+	return readLocked(id, file);
+}
+
+
+/**
+ * Returns location of record with id, while store is being written it's the location in the new
+ * file.
+ */
+DetailsStore::Location DetailsStore::getLocation(const quint32 id) {
+	QMutexLocker locker(&mutex);
+	const QVector<Location> &list = (new_file != nullptr) ? new_location_list : location_list;
+	if(id == 0 || int(id) > list.size()) return Location{-1, 0};
+	return list[id - 1];
+}
+
+
+/**
+ * Starts rewriting store, blocks anything else using it (on other threads) until commitWrite() or
+ * cancelWrite().
+ *
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if new store fails to open.
+ */
+void DetailsStore::beginWrite() {
+	mutex.lock();
+
+	// Old file doesn't exist the first time, then there's just nothing to copy
+	old_file = new QFile(path);
+	old_file->open(QIODevice::ReadOnly);
+
+	// New generation goes next to old one, which library.xml on disk still refers to
+	new_path = nextPath();
+	new_file = new QSaveFile(new_path);
+	if(!new_file->open(QIODevice::WriteOnly)) {
+		cancelWrite();
+		throw eComics::Exception(eComics::FILE_ERROR, "DetailsStore::beginWrite()",
+				QString("Failed to open ") + new_path + " for writing");
+	}
+
+	new_location_list = QVector<Location>(location_list.size(), Location{-1, 0});
+}
+
+
+/**
+ * Writes record with id to new store, if id is 0 then it's a new record and is given an id.
+ * Returns id of record.
+ */
+quint32 DetailsStore::write(quint32 id, const QByteArray &record) {
+	if(id == 0) {
+		location_list << Location{-1, 0};
+		new_location_list << Location{-1, 0};
+		id = location_list.size();
+	}
+
+	new_location_list[id - 1] = Location{new_file->pos(), record.size()};
+	new_file->write(record);
+
+	return id;
+}
+
+
+/**
+ * Copies record with id from old store to new store unchanged, returns id.
+ */
+quint32 DetailsStore::copy(const quint32 id) {
+	if(id == 0) return 0;
+	return write(id, readLocked(id, *old_file));
+}
+
+
+/**
+ * Switches to new store, records that weren't written or copied are gone. Old file is left in
+ * place until removeStale().
+ *
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if new store fails to be written.
+ */
+void DetailsStore::commitWrite() {
+	bool committed = new_file->commit();
+	if(committed) {
+		location_list = new_location_list;
+		path = new_path;
+	}
+
+	delete old_file;
+	delete new_file;
+	old_file = nullptr;
+	new_file = nullptr;
+	new_location_list.clear();
+	mutex.unlock();
+
+	if(!committed) {
+		throw eComics::Exception(eComics::FILE_ERROR, "DetailsStore::commitWrite()",
+				QString("Failed to write ") + new_path);
+	}
+}
+
+
+/**
+ * Stops rewriting store, leaving old one as it was.
+ */
+void DetailsStore::cancelWrite() {
+	new_file->cancelWriting();
+
+	delete old_file;
+	delete new_file;
+	old_file = nullptr;
+	new_file = nullptr;
+	new_location_list.clear();
+	mutex.unlock();
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									DETAILSSTORE WRITER METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if new store fails to open.
+ */
+DetailsStore::Writer::Writer() {
+	beginWrite();
+}
+
+
+DetailsStore::Writer::~Writer() {
+	if(!finished) cancelWrite();
+}
+
+
+/**
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if new store fails to be written.
+ */
+void DetailsStore::Writer::commit() {
+	// commitWrite() ends the write whether or not it succeeds
+	finished = true;
+	commitWrite();
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									DETAILSSTORE PRIVATE METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Reads record with id from file, mutex must be locked.
+ */
+QByteArray DetailsStore::readLocked(const quint32 id, QFile &file) {
+	if(id == 0 || int(id) > location_list.size() || !file.isOpen()) return QByteArray();
+
+	const Location &location = location_list[id - 1];
+	if(location.offset < 0 || !file.seek(location.offset)) return QByteArray();
+
+	return file.read(location.size);
+
+
+
+/**
+ * Returns path of next generation of store, e.g. library-details.dat (from before stores had
+ * generations) or library-details.4.dat is followed by library-details.5.dat.
+ */
+QString DetailsStore::nextPath() {
+	const QFileInfo info(path);
+	const quint32 generation = info.completeSuffix().section('.', 0, -2).toUInt();
+
+	return info.dir().filePath(QString("%1.%2.dat").arg(info.baseName()).arg(generation + 1));
+}
\ No newline at end of file
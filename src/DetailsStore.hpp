@@ -0,0 +1,98 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * DetailsStore.hpp                                                            *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef DETAILSSTORE_HPP
+#define DETAILSSTORE_HPP
+
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+
+class QFile;
+class QSaveFile;
+
+
+/**
+ * class DetailsStore
+ *
+ * File (next to library.xml) holding the cold tier of every comic's ComicInfo, it's summary, notes,
+ * and page list. These are only needed by ComicInfoDialog and the Pages tab, so when the library is
+ * loaded they're left here, and read back one comic at a time the first time they're used.
+ *
+ * Each record is an opaque blob, referred to by an id that's handed out when the library is loaded
+ * or the record is first written. Ids only live as long as the program, library.xml stores each
+ * record's offset and size instead. Records are rewritten all at once by Library::save(), through a
+ * Writer, records that aren't written or copied are dropped. Each rewrite goes to a new file
+ * (library-details.<generation>.dat) named in library.xml, so whichever library.xml is on disk
+ * always has the file it's offsets refer to. Safe to use from any thread.
+ */
+class DetailsStore {
+	public:
+		struct Location {
+			qint64 offset;
+			qint32 size;
+		};
+
+		/**
+		 * Calls beginWrite() when constructed, and cancelWrite() when destroyed unless commit() was
+		 * called, so an exception thrown while writing can't leave store locked.
+		 */
+		class Writer {
+			public:
+				Writer();
+				~Writer();
+				void commit();
+
+			private:
+				bool finished = false;
+
+				Writer(const Writer &) = delete;
+				Writer &operator=(const Writer &) = delete;
+		};
+
+		static void setPath(const QString &_path);
+		static QString getPath();
+		static void removeStale();
+		static quint32 add(const Location &location);
+		static QByteArray read(const quint32 id);
+		static Location getLocation(const quint32 id);
+		static void beginWrite();
+		static quint32 write(quint32 id, const QByteArray &record);
+		static quint32 copy(const quint32 id);
+		static void commitWrite();
+		static void cancelWrite();
+
+	private:
+		static QString path;
+		static QString new_path; // File being written, becomes path on commit
+		static QVector<Location> location_list; // Location of record with id at [id - 1]
+		static QVector<Location> new_location_list; // Locations in file being written
+		static QFile *old_file; // Store being rewritten, records are copied from it
+		static QSaveFile *new_file;
+		static QMutex mutex; // Locked while reading, or from beginWrite() until commit/cancel
+
+		static QByteArray readLocked(const quint32 id, QFile &file);
+		static QString nextPath();
+};
+
+
+#endif
\ No newline at end of file
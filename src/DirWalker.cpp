@@ -0,0 +1,197 @@
+#include "DirWalker.hpp"
+
+#include <chrono>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <QFile>
+#include <QThread>
+
+
+/**
+ * Layout of the records returned by getdents64(2), glibc doesn't expose it on all versions.
+ */
+struct linux_dirent64 {
+	quint64 d_ino;
+	qint64 d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[256];
+};
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									DIRWALKER PUBLIC METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * If _num_threads is 0 then a default is picked, stat latency rather than CPU is the bottleneck, so
+ * the default is more threads than cores.
+ */
+DirWalker::DirWalker(const int _num_threads) : pending(0), num_of_dirs(0), num_of_files(0) {
+	num_threads = (_num_threads > 0) ? _num_threads : qMax(4, QThread::idealThreadCount() * 2);
+}
+
+
+/**
+ * Walks every directory tree in root_list, blocks until all of them have been walked.
+ */
+void DirWalker::walk(const QStringList &root_list) {
+	pending			=	0;
+	num_of_dirs		=	0;
+	num_of_files	=	0;
+
+	for(int i = 0; i < num_threads; i++) queue_list << new WorkQueue;
+
+	// Spread roots over threads, the rest will be spread by stealing
+	for(int i = 0; i < root_list.size(); i++) {
+		pushWork(i % num_threads, QFile::encodeName(root_list[i]));
+	}
+
+	std::vector<std::thread> thread_list;
+	for(int i = 0; i < num_threads; i++) thread_list.emplace_back(&DirWalker::run, this, i);
+	for(std::thread &thread : thread_list) thread.join();
+
+	qDeleteAll(queue_list);
+	queue_list.clear();
+}
+
+
+int DirWalker::getNumOfDirs() const { return num_of_dirs; }
+int DirWalker::getNumOfFiles() const { return num_of_files; }
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									DIRWALKER PRIVATE METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Thread loop, reads directories until there are none queued or being read by any thread. A
+ * directory being read may still queue more subdirectories, so an empty queue alone isn't enough to
+ * stop.
+ */
+void DirWalker::run(const int id) {
+	QByteArray dir_path;
+
+	while(true) {
+		if(takeWork(id, dir_path)) {
+			readDirectory(id, dir_path);
+			pending--;
+		} else if(pending == 0) {
+			return;
+		} else {
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+}
+
+
+/**
+ * Takes newest directory from this thread's deque (depth first keeps things cache friendly), if
+ * it's empty then steals oldest directory from another thread's deque (oldest directories are
+ * closest to the root, so they are likely to have the most work under them).
+ */
+bool DirWalker::takeWork(const int id, QByteArray &dir_path) {
+	{
+		WorkQueue *queue = queue_list[id];
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		if(!queue->dir_list.empty()) {
+			dir_path = queue->dir_list.back();
+			queue->dir_list.pop_back();
+			return true;
+		}
+	}
+
+	for(int i = 1; i < num_threads; i++) {
+		WorkQueue *victim = queue_list[(id + i) % num_threads];
+		std::lock_guard<std::mutex> lock(victim->mutex);
+		if(!victim->dir_list.empty()) {
+			dir_path = victim->dir_list.front();
+			victim->dir_list.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void DirWalker::pushWork(const int id, const QByteArray &dir_path) {
+	pending++;
+	WorkQueue *queue = queue_list[id];
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	queue->dir_list.push_back(dir_path);
+}
+
+
+/**
+ * Reads entries of dir_path, queuing subdirectories and passing files to onFile.
+ */
+void DirWalker::readDirectory(const int id, const QByteArray &dir_path) {
+	int fd = open(dir_path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(fd == -1) return;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0) {
+		close(fd);
+		return;
+	}
+
+	num_of_dirs++;
+
+	if(onDirectory) {
+		QStringList subdirs;
+		if(!onDirectory(QFile::decodeName(dir_path), FileStat::fromStat(st), subdirs)) {
+			for(const QString &subdir : subdirs) pushWork(id, QFile::encodeName(subdir));
+			close(fd);
+			return;
+		}
+	}
+
+	alignas(linux_dirent64) char buf[32768];
+	long len;
+
+	while((len = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0) {
+		for(long offset = 0; offset < len;) {
+			const linux_dirent64 *entry = reinterpret_cast<const linux_dirent64 *>(buf + offset);
+			const char *name = entry->d_name;
+			offset += entry->d_reclen;
+
+			// Skip "." and ".."
+			if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+			QByteArray path = dir_path + '/' + name;
+
+			if(entry->d_type == DT_DIR) {
+				pushWork(id, path);
+				continue;
+			}
+
+			// Skip sockets, fifos, devices
+			if(entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) {
+				continue;
+			}
+
+			// Follows symlinks, so symlinked files are reported as the file they point to
+			if(fstatat(fd, name, &st, 0) != 0) continue;
+
+			if(S_ISDIR(st.st_mode)) {
+				// Some filesystems don't fill in d_type, only symlinked directories are skipped
+				if(entry->d_type == DT_UNKNOWN) pushWork(id, path);
+				continue;
+			}
+
+			if(!S_ISREG(st.st_mode)) continue;
+
+			num_of_files++;
+			if(onFile) onFile(QFile::decodeName(path), FileStat::fromStat(st));
+		}
+	}
+
+	close(fd);
+}
\ No newline at end of file
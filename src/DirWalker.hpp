@@ -0,0 +1,82 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * DirWalker.hpp                                                               *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef DIRWALKER_HPP
+#define DIRWALKER_HPP
+
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <QStringList>
+#include <QVector>
+
+#include "FileStat.hpp"
+
+
+/**
+ * class DirWalker
+ *
+ * Walks directory trees with several threads at once, which hides stat latency on slow or network
+ * filesystems and on very large directories. Each thread reads directories with getdents64 and
+ * stats entries with fstatat relative to the open directory, and keeps it's own deque of
+ * subdirectories still to be read, when it runs out it steals from the other threads.
+ *
+ * Files are passed to onFile as soon as they are found, and every directory is passed to
+ * onDirectory before it is read. If onDirectory returns false then the directory isn't read, and
+ * only the subdirectories it puts in subdirs are walked. Both callbacks are called from the walker
+ * threads, so they must be thread safe. Symlinked files are reported, symlinked directories are not
+ * followed (the same as QDirIterator by default).
+ */
+class DirWalker {
+	public:
+		typedef std::function<bool(const QString &dir_path, const FileStat &dir_stat,
+			QStringList &subdirs)> DirCallback;
+		typedef std::function<void(const QString &file_path, const FileStat &file_stat)>
+			FileCallback;
+
+		DirCallback onDirectory;
+		FileCallback onFile;
+
+		DirWalker(const int _num_threads = 0);
+		void walk(const QStringList &root_list);
+		int getNumOfDirs() const;
+		int getNumOfFiles() const;
+
+	private:
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<QByteArray> dir_list;
+		};
+
+		int num_threads;
+		QVector<WorkQueue *> queue_list; // One per thread
+		std::atomic<int> pending; // Directories queued or being read
+		std::atomic<int> num_of_dirs;
+		std::atomic<int> num_of_files;
+
+		void run(const int id);
+		bool takeWork(const int id, QByteArray &dir_path);
+		void pushWork(const int id, const QByteArray &dir_path);
+		void readDirectory(const int id, const QByteArray &dir_path);
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "FileStat.hpp"
+
+#include <sys/stat.h>
+#include <QFile>
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									FILESTAT PUBLIC METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Initializes FileStat with values that were previously stored (for example in library.xml).
+ */
+FileStat::FileStat(const qint64 _size, const qint64 _modified, const quint64 _inode,
+		const bool _dir) : size(_size), modified(_modified), inode(_inode), dir(_dir) {}
+
+
+/**
+ * Stats path and returns the result, if path doesn't exist then returned FileStat isNull().
+ */
+FileStat FileStat::fromPath(const QString &path) {
+	struct stat st;
+
+	if(::stat(QFile::encodeName(path).constData(), &st) != 0) return FileStat();
+
+	return fromStat(st);
+}
+
+
+/**
+ * Converts result of stat(2) or fstatat(2).
+ */
+FileStat FileStat::fromStat(const struct stat &st) {
+	FileStat file_stat;
+
+	file_stat.size		=	st.st_size;
+	file_stat.modified	=	qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+	file_stat.inode		=	st.st_ino;
+	file_stat.dir		=	S_ISDIR(st.st_mode);
+
+	return file_stat;
+}
+
+
+/**
+ * FileStat basic getters.
+ */
+qint64 FileStat::getSize() const { return size; }
+qint64 FileStat::getModified() const { return modified; }
+quint64 FileStat::getInode() const { return inode; }
+bool FileStat::isDir() const { return dir; }
+bool FileStat::isFile() const { return !isNull() && !dir; }
+
+
+/**
+ * If size is negative then path didn't exist or FileStat was never set.
+ */
+bool FileStat::isNull() const { return size < 0; }
+
+
+bool FileStat::operator ==(const FileStat &file_stat) const {
+	return (
+		size		==	file_stat.size &&
+		modified	==	file_stat.modified &&
+		inode		==	file_stat.inode
+	);
+}
+
+
+bool FileStat::operator !=(const FileStat &file_stat) const {
+	return !(*this == file_stat);
+}
\ No newline at end of file
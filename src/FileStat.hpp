@@ -0,0 +1,60 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * FileStat.hpp                                                                *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef FILESTAT_HPP
+#define FILESTAT_HPP
+
+
+#include <QString>
+
+
+struct stat;
+
+
+/**
+ * FileStat holds the parts of stat(2) that are needed to tell if a file or directory has changed
+ * since it was last seen (size, modification time in nanoseconds, and inode). Comparing two
+ * FileStats is much cheaper than hashing a file, so scans use it to decide which paths actually
+ * need to be re-read. A default constructed FileStat isNull().
+ */
+class FileStat {
+	public:
+		FileStat() {}
+		FileStat(const qint64 _size, const qint64 _modified, const quint64 _inode,
+				const bool _dir = false);
+		static FileStat fromPath(const QString &path);
+		static FileStat fromStat(const struct stat &st);
+		qint64 getSize() const;
+		qint64 getModified() const;
+		quint64 getInode() const;
+		bool isDir() const;
+		bool isFile() const;
+		bool isNull() const;
+		bool operator ==(const FileStat &file_stat) const;
+		bool operator !=(const FileStat &file_stat) const;
+
+	private:
+		qint64 size		=	-1;
+		qint64 modified	=	0; // Nanoseconds since epoch
+		quint64 inode	=	0;
+		bool dir		=	false;
+};
+
+
+#endif
\ No newline at end of file
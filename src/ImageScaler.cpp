@@ -0,0 +1,179 @@
+#include "ImageScaler.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									IMAGESCALER PUBLIC METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Returns image scaled to width x height, mode works like it does for QImage::scaled(). Returns a
+ * null QImage if image is null or width or height is 0.
+ */
+QImage ImageScaler::scaled(const QImage &image, const int width, const int height,
+		const Qt::AspectRatioMode mode) {
+	if(image.isNull() || width <= 0 || height <= 0) return QImage();
+
+	QSize size = image.size().scaled(width, height, mode);
+	if(size == image.size()) return image;
+	if(size.width() > image.width() || size.height() > image.height()) {
+		return image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	}
+
+	QImage src = image;
+	if(
+		src.format() != QImage::Format_Grayscale8 &&
+		src.format() != QImage::Format_RGB32 &&
+		src.format() != QImage::Format_ARGB32_Premultiplied
+	) {
+		src = src.convertToFormat((src.hasAlphaChannel()) ?
+				QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+	}
+
+	int channels = (src.format() == QImage::Format_Grayscale8) ? 1 : 4;
+	int length = size.width() * channels;
+	QVector<Span> col_span_list = spans(src.width(), size.width());
+	QVector<Span> row_span_list = spans(src.height(), size.height());
+	QVector<float> src_row(length), dst_row(length);
+	int cur_src_row = -1;
+
+	QImage result(size, src.format());
+	for(int y = 0; y < size.height(); y++) {
+		const Span &span = row_span_list.at(y);
+		dst_row.fill(0);
+
+		for(int i = 0; i < span.weight_list.size(); i++) {
+			// Neighbouring output rows share the source row on their boundary, so it's reused
+			if(cur_src_row != span.first + i) {
+				cur_src_row = span.first + i;
+				scaleRow(src.constScanLine(cur_src_row), col_span_list, channels, src_row.data());
+			}
+
+			addRow(src_row.constData(), span.weight_list.at(i), length, dst_row.data());
+		}
+
+		storeRow(dst_row.constData(), length, result.scanLine(y));
+	}
+
+	return result;
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									IMAGESCALER PRIVATE METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Returns span of source pixels for each of dst_size output pixels, weights of a span add up to 1.
+ * dst_size must not be larger than src_size.
+ */
+QVector<ImageScaler::Span> ImageScaler::spans(const int src_size, const int dst_size) {
+	QVector<Span> span_list(dst_size);
+	double scale = double(src_size) / dst_size;
+
+	for(int i = 0; i < dst_size; i++) {
+		double start	=	i * scale;
+		double end		=	qMin((i + 1) * scale, double(src_size));
+		int first		=	int(start);
+		int last		=	qMin(int(std::ceil(end)), src_size) - 1;
+
+		span_list[i].first = first;
+		for(int j = first; j <= last; j++) {
+			double covered = qMin(j + 1.0, end) - qMax(double(j), start);
+			span_list[i].weight_list.append(float(covered / scale));
+		}
+	}
+
+	return span_list;
+}
+
+
+/**
+ * Scales one row of pixels horizontally into floats, channels is 4 for RGB32 or 1 for Grayscale8.
+ */
+void ImageScaler::scaleRow(const uchar *src, const QVector<Span> &span_list, const int channels,
+		float *dst) {
+	for(const Span &span : span_list) {
+		const float *weight = span.weight_list.constData();
+		int num_of_weights = span.weight_list.size();
+
+		if(channels == 1) {
+			float sum = 0;
+			for(int i = 0; i < num_of_weights; i++) sum += src[span.first + i] * weight[i];
+			*dst++ = sum;
+			continue;
+		}
+
+		const uchar *pixel = src + span.first * 4;
+
+#ifdef __SSE2__
+		// Widen the 4 bytes of each pixel to 4 floats, and sum them all at once
+		__m128i zero = _mm_setzero_si128();
+		__m128 sum = _mm_setzero_ps();
+		for(int i = 0; i < num_of_weights; i++, pixel += 4) {
+			qint32 bytes;
+			std::memcpy(&bytes, pixel, 4);
+			__m128i value = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+			value = _mm_unpacklo_epi16(value, zero);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(weight[i])));
+		}
+
+		_mm_storeu_ps(dst, sum);
+#else
+		dst[0] = dst[1] = dst[2] = dst[3] = 0;
+		for(int i = 0; i < num_of_weights; i++, pixel += 4) {
+			for(int c = 0; c < 4; c++) dst[c] += pixel[c] * weight[i];
+		}
+#endif
+
+		dst += 4;
+	}
+}
+
+
+/**
+ * Adds length floats from src, multiplied by weight, to dst.
+ */
+void ImageScaler::addRow(const float *src, const float weight, const int length, float *dst) {
+	int i = 0;
+
+#ifdef __SSE2__
+	__m128 factor = _mm_set1_ps(weight);
+	for(; i + 4 <= length; i += 4) {
+		__m128 sum = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), factor));
+		_mm_storeu_ps(dst + i, sum);
+	}
+#endif
+
+	for(; i < length; i++) dst[i] += src[i] * weight;
+}
+
+
+/**
+ * Rounds length floats from src to bytes in dst, they're already in range, only rounding error can
+ * push them past it.
+ */
+void ImageScaler::storeRow(const float *src, const int length, uchar *dst) {
+	int i = 0;
+
+#ifdef __SSE2__
+	// Packing saturates, so it also clamps to 0-255
+	for(; i + 4 <= length; i += 4) {
+		__m128i value = _mm_cvtps_epi32(_mm_loadu_ps(src + i));
+		__m128i words = _mm_packs_epi32(value, value);
+		value = _mm_packus_epi16(words, words);
+		qint32 bytes = _mm_cvtsi128_si32(value);
+		std::memcpy(dst + i, &bytes, 4);
+	}
+#endif
+
+	for(; i < length; i++) dst[i] = uchar(qBound(0, int(src[i] + 0.5f), 255));
+}
\ No newline at end of file
@@ -1,14 +1,29 @@
 #include "Library.hpp"
 
+#include <algorithm>
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QErrorMessage>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QMutex>
 #include <QProgressDialog>
+#include <QSaveFile>
+#ifdef ECOMICS_MEMORY_STATS
+#include <unistd.h>
+#endif
 
 #include "ConfirmationDialog.hpp"
+#include "DetailsStore.hpp"
+#include "DirWalker.hpp"
 #include "LibraryView.hpp"
+#include "LibraryWatcher.hpp"
 #include "MainWindow.hpp"
+#include "MetadataWriter.hpp"
+#include "ScanPipeline.hpp"
 #include "SplashScreen.hpp"
+#include "StringPool.hpp"
+#include "ThumbnailService.hpp"
 
 
 Library *library = nullptr;
@@ -22,6 +37,9 @@ LibraryWorker *Library::worker;
 
 void Library::init() {
 	if(library == nullptr) {
+		// Comics may be saved, or need thumbnails, while library is loading, so these come first
+		MetadataWriter::init();
+		ThumbnailService::init();
 		library = new Library;
 
 		// Start splash screen and connect it to library
@@ -58,6 +76,9 @@ void Library::init() {
 		// When finished make sure to disconnect worker method from thread
 		disconnect(library->thread, SIGNAL(started()), library->worker, SLOT(scanDirectories()));
 
+		// Pick up any changes made outside of eComics from now on
+		LibraryWatcher::init();
+
 		splash_screen->finish();
 	}
 }
@@ -65,6 +86,23 @@ void Library::init() {
 
 void Library::destroy() {
 	if(library != nullptr) {
+		LibraryWatcher::destroy();
+
+		// Record thumbnails already generated, drop thumbnails of covers no longer in library, then
+		// stop generating them
+		library->applyCoverHashes();
+		QSet<QByteArray> live_cover_hashes;
+		for(const ComicFile &comic : *library) live_cover_hashes << comic.getCoverHash();
+		try {
+			thumbnail_service->compact(live_cover_hashes);
+		} catch(const eComics::Exception &e) { e.printMsg(); }
+		ThumbnailService::destroy();
+
+		// Finish any queued metadata writes, then record the new stats they produced
+		MetadataWriter::destroy();
+		QCoreApplication::sendPostedEvents(library);
+		library->applyWrittenComics();
+
 		delete library;
 		library = nullptr;
 	}
@@ -73,13 +111,28 @@ void Library::destroy() {
 
 void Library::append(const ComicFile &comic) {
 	QList<ComicFile>::append(comic);
-	emit (*this)[comic.getPath()].addedToLibrary();
+	indexComic(size() - 1);
+	adoptComic(last());
+	onChanged();
 }
 
 
+/**
+ * Bulk insert, comics are indexed as they're appended, so the index doesn't have to be rebuilt.
+ */
 void Library::append(const QList<ComicFile> &comic_list) {
+	if(comic_list.isEmpty()) return;
+
+	int first = size();
+	reserve(size() + comic_list.size());
 	QList<ComicFile>::append(comic_list);
-	for(ComicFile comic : comic_list) emit (*this)[comic.getPath()].addedToLibrary();
+
+	for(int i = first; i < size(); i++) {
+		indexComic(i);
+		adoptComic((*this)[i]);
+	}
+
+	onChanged();
 }
 
 
@@ -192,13 +245,7 @@ ReferenceList<ComicFile> Library::comicsFromVolume(const QString &series, const
  * Returns true if comic with md5 hash exists in library, otherwise returns false
  */
 bool Library::contains(const QByteArray &md5_hash) const {
-	for(int i = 0; i < this->length(); i++) {
-		if((*this)[i].getMd5Hash() == md5_hash) {
-			return true;
-		}
-	}
-
-	return false;
+	return indexOf(md5_hash) != -1;
 }
 
 
@@ -206,24 +253,13 @@ bool Library::contains(const QByteArray &md5_hash) const {
  * Reimplemented method, return true if comic with path exists in library, otherwise returns false.
  */
 bool Library::contains(QString path) const {
-	for(int i = 0; i < this->length(); i++) {
-		if((*this)[i].getPath() == path) {
-			return true;
-		}
-	}
-
-	return false;
+	return indexOf(path) != -1;
 }
 
 
 int Library::indexOf(const QByteArray &md5_hash) const {
-	for(int i = 0; i <= this->size(); i++) {
-		if((*this)[i].getMd5Hash() == md5_hash) {
-			return i;
-		}
-	}
-
-	return -1;
+	if(!index_valid) buildIndex();
+	return md5_hash_index.value(md5_hash, -1);
 }
 
 
@@ -231,115 +267,168 @@ int Library::indexOf(const QByteArray &md5_hash) const {
  * Reimplemented method, return index of comic with path, returns -1 if it doesn't exist in library.
  */
 int Library::indexOf(const QString &path) const {
-	for(int i = 0; i <= this->size(); i++) {
-		if((*this)[i].getPath() == path) {
-			return i;
-		}
-	}
-
-	return -1;
+	if(!index_valid) buildIndex();
+	return path_index.value(path, -1);
 }
 
 
 void Library::insert(int i, const ComicFile &comic) {
 	QList<ComicFile>::insert(i, comic);
-	emit (*this)[comic.getPath()].addedToLibrary();
+	invalidateIndex();
+	adoptComic((*this)[i]);
+	onChanged();
 }
 
 
 typedef QList<ComicFile>::iterator iterator;
 iterator Library::insert(iterator before, const ComicFile &comic) {
 	iterator iter = QList<ComicFile>::insert(before, comic);
-	emit iter->addedToLibrary();
+	invalidateIndex();
+	adoptComic(*iter);
+	onChanged();
 	return iter;
 }
 
 
 void Library::push_back(const ComicFile &comic) {
-	QList<ComicFile>::push_back(comic);
-	emit (*this)[comic.getPath()].addedToLibrary();
+	append(comic);
 }
 
 
 void Library::push_front(const ComicFile &comic) {
-	QList<ComicFile>::push_front(comic);
-	emit (*this)[comic.getPath()].addedToLibrary();
+	insert(0, comic);
 }
 
 
 int Library::removeAll(const ComicFile &comic) {
 	int result = QList::removeAll(comic);
-	save();
+	if(result > 0) {
+		invalidateIndex();
+		onChanged();
+	}
+
 	return result;
 }
 
 
 void Library::removeAt(int i) {
 	QList::removeAt(i);
-	save();
+	invalidateIndex();
+	onChanged();
 }
 
 
 void Library::removeFirst() {
 	QList::removeFirst();
-	save();
+	invalidateIndex();
+	onChanged();
 }
 
 
 void Library::removeLast() {
 	QList::removeLast();
-	save();
+	invalidateIndex();
+	onChanged();
 }
 
 
 bool Library::removeOne(const ComicFile &comic) {
 	bool result = QList::removeOne(comic);
-	save();
+	if(result) {
+		invalidateIndex();
+		onChanged();
+	}
+
 	return result;
 }
 
 
+/**
+ * Bulk remove, removes every comic whose path is in path_set in a single pass, returns number of
+ * comics removed.
+ */
+int Library::removePaths(const QSet<QString> &path_set) {
+	if(path_set.isEmpty()) return 0;
+
+	int num_removed = 0;
+
+	// Erase each run of removed comics at once, going backwards so runs still to be erased don't move
+	for(int end = size(); end > 0;) {
+		if(!path_set.contains(at(end - 1).getPath())) {
+			end--;
+			continue;
+		}
+
+		int first = end - 1;
+		while(first > 0 && path_set.contains(at(first - 1).getPath())) first--;
+
+		erase(QList::begin() + first, QList::begin() + end);
+		num_removed += end - first;
+		end = first;
+	}
+
+	if(num_removed > 0) {
+		invalidateIndex();
+		onChanged();
+	}
+
+	return num_removed;
+}
+
+
 void Library::replace(int i, const ComicFile &comic) {
 	QList<ComicFile>::replace(i, comic);
-	emit (*this)[comic.getPath()].addedToLibrary();
+	invalidateIndex();
+	adoptComic((*this)[i]);
+	onChanged();
 }
 
 
 /**
- * Saves all comics/manga in library to library.xml.
+ * Saves all comics/manga in library to library.xml, if a transaction is open then saving is left to
+ * commit(). library.xml is written to a temp file and only replaces the old one once details store
+ * has been committed, so a failed save leaves both as they were.
  *
  * Possible Exceptions:
- * - FILE_ERROR may be thrown if library file fails to open.
+ * - FILE_ERROR may be thrown if library file or details store fails to open or be written.
  */
 void Library::save() {
-	if(batch_editing) {
+	if(transaction_depth > 0) {
 		dirty = true;
 		return;
 	}
 
 	qDebug() << "Saving changes to library...";
 	// Open file for writing
-	if(!file->open(QIODevice::WriteOnly | QIODevice::Text)) {
+	QSaveFile save_file(file->fileName());
+	if(!save_file.open(QIODevice::WriteOnly | QIODevice::Text)) {
 		throw eComics::Exception(eComics::FILE_ERROR, "Library::save()",
 			QString("Failed to open ") + file->fileName() + " for writing");
 	}
 
+	// Details are rewritten alongside library.xml, which stores where each comic's details are,
+	// cancelled if anything below throws
+	DetailsStore::Writer details_writer;
+
 	// Prepare xml writer, and start xml file
-	QXmlStreamWriter writer(file);
+	QXmlStreamWriter writer(&save_file);
 	writer.setAutoFormatting(true);
 	writer.setAutoFormattingIndent(-1);
 	writer.writeStartDocument("1.0");
 	writer.writeStartElement("Library");
+	writer.writeAttribute("Details", QFileInfo(DetailsStore::getPath()).fileName());
 
 	writer.writeStartElement("Comics");
 
 	// Loop through comics adding to library file
 	for(int comic_index = 0; comic_index < this->size(); comic_index++) {
-		const ComicFile &cur_comic = (*this)[comic_index];
+		ComicFile &cur_comic = (*this)[comic_index];
 		writer.writeStartElement("Comic");
 
-		// Loop through all the metadata tags in comic
+		// Loop through all the metadata tags in comic, details tags are in details store
 		for(int meta_index = 0; meta_index < cur_comic.info.size(); meta_index++) {
+			if(ComicInfo::isDetailsTag(meta_index)) continue;
+
 			// If current metadata value is not empty, add it
 			if(!cur_comic.info.at(meta_index).getValue().isEmpty()) {
 				writer.writeTextElement(
@@ -349,42 +438,15 @@ void Library::save() {
 			}
 		}
 
-		writer.writeStartElement("Pages");
-		// Loop through pages adding to library
-		for(int page_index = 0; page_index < cur_comic.info.page_list.size(); page_index++) {
-			const Page &cur_page = cur_comic.info.page_list[page_index];
-			writer.writeEmptyElement("Page");
-			// Image is a required field, so it will always be filled
-			writer.writeAttribute("Image", QString::number(page_index));
-
-			// For the rest, if they are empty don't add them
-			if(!cur_page.getType().isEmpty()) {
-				writer.writeAttribute("Type", cur_page.getType());
-			}
-
-			if(!cur_page.getDoublePage().isEmpty()) {
-				writer.writeAttribute("DoublePage", cur_page.getDoublePage());
-			}
-
-			if(!cur_page.getImageSize().isEmpty()) {
-				writer.writeAttribute("ImageSize", cur_page.getImageSize());
-			}
-
-			if(!cur_page.getKey().isEmpty()) {
-				writer.writeAttribute("Key", cur_page.getKey());
-			}
-
-			if(!cur_page.getImageWidth().isEmpty()) {
-				writer.writeAttribute("ImageWidth", cur_page.getImageWidth());
-			}
-
-			if(!cur_page.getImageHeight().isEmpty()) {
-				writer.writeAttribute("ImageHeight", cur_page.getImageHeight());
-			}
+		// Write where comic's summary, notes, and pages are in details store
+		quint32 details_id = cur_comic.info.saveDetails();
+		if(details_id != 0) {
+			DetailsStore::Location location = DetailsStore::getLocation(details_id);
+			writer.writeEmptyElement("Details");
+			writer.writeAttribute("Offset", QString::number(location.offset));
+			writer.writeAttribute("Size", QString::number(location.size));
 		}
 
-		writer.writeEndElement(); // </Pages>
-
 		// Write path of comic in library
 		writer.writeTextElement("Path", cur_comic.getPath());
 
@@ -393,83 +455,188 @@ void Library::save() {
 			writer.writeTextElement("Md5Hash", cur_comic.getMd5Hash());
 		}
 
+		// Write fingerprint of comic's pages, so metadata only changes can be told apart
+		if(!cur_comic.getContentHash().isEmpty()) {
+			writer.writeTextElement("ContentHash", cur_comic.getContentHash());
+		}
+
+		// Write hash of comic's ComicInfo xml, so saves that wouldn't change it are skipped
+		if(!cur_comic.getXmlHash().isEmpty()) {
+			writer.writeTextElement("XmlHash", cur_comic.getXmlHash());
+		}
+
+		// Write hash of comic's cover, which it's thumbnail is named after
+		if(!cur_comic.getCoverHash().isEmpty()) {
+			writer.writeTextElement("CoverHash", cur_comic.getCoverHash());
+		}
+
+		// Write stat of comic when md5 hash was generated, so scans can skip unchanged files
+		const FileStat file_stat = cur_comic.getFileStat();
+		if(!file_stat.isNull()) {
+			writer.writeTextElement("FileSize", QString::number(file_stat.getSize()));
+			writer.writeTextElement("Modified", QString::number(file_stat.getModified()));
+			writer.writeTextElement("Inode", QString::number(file_stat.getInode()));
+		}
+
 		writer.writeEndElement(); // </Comic>
 	}
 
-	// Finish writing library file and close
 	writer.writeEndElement(); // </Comics>
+
+	// Write modification times of scanned directories, so unchanged directories aren't re-listed
+	writer.writeStartElement("Directories");
+	for(auto iter = dir_cache.constBegin(); iter != dir_cache.constEnd(); ++iter) {
+		writer.writeEmptyElement("Directory");
+		writer.writeAttribute("Path", iter.key());
+		writer.writeAttribute("Modified", QString::number(iter.value()));
+	}
+	writer.writeEndElement(); // </Directories>
+
+	// Finish writing library file
 	writer.writeEndElement(); // </Library>
-	file->close();
+
+	if(writer.hasError()) {
+		throw eComics::Exception(eComics::FILE_ERROR, "Library::save()",
+			QString("Failed to write ") + file->fileName());
+	}
+
+	// Details go to a new file, so committing them first leaves the file library.xml on disk
+	// refers to untouched, whether library.xml then commits or not (or program dies in between).
+	// Old details file is only removed once library.xml naming the new one is committed
+	details_writer.commit();
+	if(!save_file.commit()) {
+		throw eComics::Exception(eComics::FILE_ERROR, "Library::save()",
+			QString("Failed to write ") + file->fileName());
+	}
+
+	DetailsStore::removeStale();
 	dirty = false;
 }
 
 
 /**
- * Sets batch_editing to true, Library will not save until finishBatchEditing() is called. This
- * should be called if editing metadata of multiple comics, otherwise Library will save to disk on
- * every single comic that is changed, this way it will only save to disk once you are finished
- * editing comic metadata.
+ * Applies changes found by LibraryWatcher. Renamed paths (files or directories) only update the
+ * path of comics already in library, removed paths are dropped from library, and changed paths are
+ * read on the worker thread, then added or replaced in onWorkerFinished(). If the worker is busy
+ * then the changes are queued until it's finished.
+ */
+void Library::updatePaths(const QList<QPair<QString, QString>> &renamed_paths,
+		const QStringList &removed_paths, const QStringList &changed_paths) {
+	if(thread->isRunning()) {
+		pending_renamed_paths	+=	renamed_paths;
+		pending_removed_paths	+=	removed_paths;
+		pending_changed_paths	+=	changed_paths;
+		return;
+	}
+
+	beginTransaction();
+
+	for(const QPair<QString, QString> &pair : renamed_paths) {
+		for(ComicFile &comic : *library) {
+			if(comic.getPath() == pair.first || comic.getPath().startsWith(pair.first + "/")) {
+				qDebug() << "Moved in library:" << comic.getPath() << "->" <<
+					pair.second + comic.getPath().mid(pair.first.size());
+				comic.setPath(pair.second + comic.getPath().mid(pair.first.size()));
+				dirty = notify_pending = true;
+			}
+		}
+	}
+
+	// Removed paths may be directories, so collect every comic inside them and remove all at once
+	QSet<QString> remove_set;
+	for(const QString &path : removed_paths) {
+		for(const ComicFile &comic : *this) {
+			if(comic.getPath() == path || comic.getPath().startsWith(path + "/")) {
+				qDebug() << "Removed from library:" << comic.getPath();
+				remove_set.insert(comic.getPath());
+			}
+		}
+	}
+	removePaths(remove_set);
+
+	// Only re-read files that are new, or that don't match what's in library
+	for(const QString &path : changed_paths) {
+		FileStat file_stat = FileStat::fromPath(path);
+		if(!file_stat.isFile()) continue;
+		if(contains(path) && at(path).getFileStat() == file_stat) continue;
+		if(!worker->paths.contains(path)) worker->paths << path;
+	}
+
+	commit();
+
+	if(!worker->paths.isEmpty()) {
+		connect(thread, SIGNAL(started()), worker, SLOT(updatePaths()));
+		thread->start();
+	}
+}
+
+
+/**
+ * Starts a transaction, until the matching commit() library isn't saved and changed() isn't
+ * emitted, no matter how many comics are added, removed, or edited. Transactions can be nested,
+ * only the outermost commit() has any effect. This should be used for anything that changes more
+ * than one comic, otherwise Library will save to disk on every single change.
  */
-void Library::startBatchEditing() {
-	batch_editing = true;
+void Library::beginTransaction() {
+	transaction_depth++;
 }
 
 
 /**
- * Sets batch_editing to false and saves library.
+ * Ends a transaction, if it's the outermost one then library is saved once and changed() is
+ * emitted once for everything done during the transaction.
  */
-void Library::finishBatchEditing() {
-	batch_editing = false;
-	if(dirty) save();
+void Library::commit() {
+	if(transaction_depth > 0 && --transaction_depth > 0) return;
+
+	if(dirty) try { save(); } catch(const eComics::Exception &e) { e.printMsg(); }
+
+	if(notify_pending) {
+		notify_pending = false;
+		emit changed();
+	}
 }
 
 
 const ComicFile & Library::at(const QByteArray &md5_hash) const {
-	if(this->contains(md5_hash)) {
-		return this->at(this->indexOf(md5_hash));
-	} else return null;
+	int i = indexOf(md5_hash);
+	return (i == -1) ? null : at(i);
 }
 
 
 const ComicFile & Library::at(const QString &path) const {
-	if(this->contains(path)) {
-		return this->at(this->indexOf(path));
-	} else return null;
+	int i = indexOf(path);
+	return (i == -1) ? null : at(i);
 }
 
 
 Library & Library::operator+=(const QList<ComicFile> &comic_list) {
-	QList<ComicFile>::operator+=(comic_list);
-	for(ComicFile comic : comic_list) emit (*this)[comic.getPath()].addedToLibrary();
+	append(comic_list);
 	return *this;
 }
 
 
 Library & Library::operator+=(const ComicFile &comic) {
-	QList<ComicFile>::operator+=(comic);
-	emit (*this)[comic.getPath()].addedToLibrary();
+	append(comic);
 	return *this;
 }
 
 
 Library & Library::operator<<(const QList<ComicFile> &comic_list) {
-	QList<ComicFile>::operator<<(comic_list);
-	for(ComicFile comic : comic_list) emit (*this)[comic.getPath()].addedToLibrary();
+	append(comic_list);
 	return *this;
 }
 
 
 Library & Library::operator<<(const ComicFile &comic) {
-	QList<ComicFile>::operator<<(comic);
-	emit (*this)[comic.getPath()].addedToLibrary();
+	append(comic);
 	return *this;
 }
 
 
 ComicFile & Library::operator[](const QByteArray &md5_hash) {
-	if(this->contains(md5_hash)) {
-		return (*this)[this->indexOf(md5_hash)];
-	} else return null;
+	int i = indexOf(md5_hash);
+	return (i == -1) ? null : (*this)[i];
 }
 
 
@@ -479,9 +646,8 @@ const ComicFile & Library::operator[](const QByteArray &md5_hash) const {
 
 
 ComicFile & Library::operator[](const QString &path) {
-	if(this->contains(path)) {
-		return (*this)[this->indexOf(path)];
-	} else return null;
+	int i = indexOf(path);
+	return (i == -1) ? null : (*this)[i];
 }
 
 
@@ -500,6 +666,8 @@ void Library::addComics() {
 								QDir::homePath(),
 								"Comic files(*.cb7 *.7z *.cbr *.rar *.cbz *zip *.pdf)");
 
+	beginTransaction();
+
 	for(QString path : path_list) {
 		ComicFile comic(path);
 
@@ -509,17 +677,25 @@ void Library::addComics() {
 		} else {
 			comic.move();
 			this->append(comic);
-			library_view->refreshModel();
 		}
 	}
+
+	commit();
 }
 
 
 /**
  * Moves files to appropriate directories, deletes all empty directories, then saves everything to
- * library.
+ * library. Empty directories are found and deleted by worker thread, see
+ * LibraryWorker::deleteEmptyDirs().
  */
 void Library::cleanupFiles() {
+	// If worker is busy applying watched changes, clean up when it's done
+	if(thread->isRunning()) {
+		cleanup_pending = true;
+		return;
+	}
+
 	// Prepare progress dialog
 	QProgressDialog progress_dialog(tr("Moving files..."), 0, 0, this->size(), main_window);
 	progress_dialog.setWindowModality(Qt::WindowModal);
@@ -529,67 +705,36 @@ void Library::cleanupFiles() {
 	progress_dialog.setValue(0);
 	int i = 0;
 
+	beginTransaction();
+
 	// Move each comic to it's appropriate directory
 	for(ComicFile &comic : *this) {
 		comic.move();
 		progress_dialog.setValue(++i);
 	}
 
+	dirty = notify_pending = true;
+
 	// Update progress dialog and set indeterminate
 	progress_dialog.setLabelText(tr("Deleting empty folders..."));
 	progress_dialog.setMaximum(0);
-	progress_dialog.show();
 	progress_dialog.setValue(0);
+	connect(thread, SIGNAL(finished()), &progress_dialog, SLOT(accept()));
 
-	// Scan directories for empty folders and delete them
-	QDirIterator *cur = nullptr;
-
-	// 2x loop, once for comics, another for manga
-	for(int count = 1; count <= 2; count++) {
-		QApplication::processEvents();
-		// On first iteration set cur to comic dir if it's enabled, on second do manga
-		switch(count) {
-			case 1:
-				if(config->isComicEnabled()) {
-					cur = new QDirIterator(config->getComicDir(), QDirIterator::Subdirectories);
-				} else {
-					continue;
-				}
-				break;
-
-			case 2:
-				if(config->isMangaEnabled()) {
-					cur = new QDirIterator(config->getMangaDir(), QDirIterator::Subdirectories);
-				} else {
-					goto done_cleaning;
-				}
-		}
-
-		// Loop through current directory iterator getting comics
-		while(cur->hasNext()) {
-			QApplication::processEvents();
-			cur->next();
-
-			// If not a dir, skip
-			if(!cur->fileInfo().isDir()) continue;
-
-			QDir cur_dir = cur->fileInfo().dir();
+	// Connect worker method to event loop
+	connect(thread, SIGNAL(started()), worker, SLOT(deleteEmptyDirs()));
 
-			// If dir is empty, delete it, and any empty parent directories
-			if(cur_dir.entryInfoList(QDir::NoDotAndDotDot|QDir::AllEntries).count() == 0) {
-				cur_dir.rmpath(cur_dir.absolutePath());
-			}
-		}
+	// Start thread and event loop
+	thread->start();
+	progress_dialog.exec();
 
-		// Reset cur
-		delete cur;
-		cur = nullptr;
-	}
+	// When finished make sure to disconnect worker method from thread
+	disconnect(thread, SIGNAL(started()), worker, SLOT(deleteEmptyDirs()));
 
-	done_cleaning:
-		progress_dialog.setLabelText(tr("Saving library..."));
-		QApplication::processEvents();
-		save();
+	progress_dialog.show();
+	progress_dialog.setLabelText(tr("Saving library..."));
+	QApplication::processEvents();
+	commit();
 }
 
 
@@ -613,10 +758,14 @@ void Library::deleteSelectedComics() {
 	msg += "\n\nCan not be undone!";
 
 	if(ConfirmationDialog::exec(title, msg, main_window)) {
-		for(ComicFile comic : selected_list) {
-			QString path = comic.getPath().mid(0, comic.getPath().lastIndexOf("/"));
-			this->removeOne(comic);
-			comic.remove();
+		// Copy paths first, removing comics from library invalidates selected_list
+		QStringList path_list;
+		for(const ComicFile &comic : selected_list) path_list << comic.getPath();
+		removePaths(path_list.toSet());
+
+		for(const QString &file_path : path_list) {
+			QString path = file_path.mid(0, file_path.lastIndexOf("/"));
+			QFile::remove(file_path);
 
 			// Remove folders if empty
 			if(QDir(path).entryInfoList(QDir::NoDotAndDotDot|QDir::AllEntries).count() == 0) {
@@ -630,8 +779,6 @@ void Library::deleteSelectedComics() {
 				root_dir.rmpath(path);
 			}
 		}
-
-		library_view->refreshModel();
 	}
 }
 
@@ -656,13 +803,17 @@ void Library::removeSelectedComics() {
 	msg += "\n\nFile(s) will be moved to desktop.";
 
 	if(ConfirmationDialog::exec(title, msg, main_window)) {
-		for(ComicFile comic : selected_list) {
-			QString path = comic.getPath().mid(0, comic.getPath().lastIndexOf("/"));
-			QString name = comic.getPath().mid(comic.getPath().lastIndexOf("/") + 1);
-			this->removeOne(comic);
+		// Copy paths first, removing comics from library invalidates selected_list
+		QStringList path_list;
+		for(const ComicFile &comic : selected_list) path_list << comic.getPath();
+		removePaths(path_list.toSet());
+
+		for(const QString &file_path : path_list) {
+			QString path = file_path.mid(0, file_path.lastIndexOf("/"));
+			QString name = file_path.mid(file_path.lastIndexOf("/") + 1);
 
 			// Move to desktop
-			QDir("/").rename(comic.getPath(), QDir::homePath() + "/Desktop/" + name);
+			QDir("/").rename(file_path, QDir::homePath() + "/Desktop/" + name);
 
 			// Remove folders if empty
 			if(QDir(path).entryInfoList(QDir::NoDotAndDotDot|QDir::AllEntries).count() == 0) {
@@ -676,8 +827,6 @@ void Library::removeSelectedComics() {
 				root_dir.rmpath(path);
 			}
 		}
-
-		library_view->refreshModel();
 	}
 }
 
@@ -687,6 +836,12 @@ void Library::removeSelectedComics() {
  * dialog waiting the main thread.
  */
 void Library::scanDirectories() {
+	// If worker is busy applying watched changes, scan when it's done
+	if(thread->isRunning()) {
+		rescan_pending = true;
+		return;
+	}
+
 	// Prepare progress dialog
 	QProgressDialog progress_dialog(tr("Scanning directories..."), 0, 0, 0, main_window);
 	progress_dialog.setWindowModality(Qt::WindowModal);
@@ -717,14 +872,29 @@ Library::Library() {
 
 	// Initialize file pointer
 	file = new QFile(config->getRootDir().absolutePath() + "/library.xml");
+	DetailsStore::setPath(config->getRootDir().absolutePath() + "/library-details.dat");
 
 	// Initialize library worker and it's thread
 	worker	=	new LibraryWorker();
 	thread	=	new QThread();
 	worker->moveToThread(thread);
+	qRegisterMetaType<QList<ComicFile *>>("QList<ComicFile*>");
 
 	// Connect signals for worker and it's thread
 	connect(this, SIGNAL(finishedWorker(const QString &)), thread, SLOT(quit()));
+	connect(thread, SIGNAL(finished()), this, SLOT(onWorkerFinished()));
+
+	// Update comics once their metadata has been written to disk
+	connect(metadata_writer, SIGNAL(written(const QString &, const FileStat &, const QByteArray &)),
+			this, SLOT(onMetadataWritten(const QString &, const FileStat &, const QByteArray &)));
+	connect(metadata_writer, SIGNAL(failed(const QString &, const QString &)), this,
+			SLOT(onMetadataFailed(const QString &)));
+
+	// Record cover hashes of generated thumbnails, a few seconds after the last one
+	cover_timer.setSingleShot(true);
+	cover_timer.setInterval(COVER_DELAY);
+	connect(&cover_timer, SIGNAL(timeout()), this, SLOT(applyCoverHashes()));
+	connect(thumbnail_service, SIGNAL(thumbReady(const QByteArray &)), &cover_timer, SLOT(start()));
 
 	// Connect actions
 	eComics::Actions *actions = eComics::actions;
@@ -743,6 +913,255 @@ Library::~Library() {
 }
 
 
+#ifdef ECOMICS_MEMORY_STATS
+/**
+ * Returns resident memory of process in bytes, or 0 if it can't be read.
+ */
+qint64 Library::getResidentMemory() {
+	QFile statm("/proc/self/statm");
+	if(!statm.open(QIODevice::ReadOnly)) return 0;
+
+	// Second field is resident pages
+	QList<QByteArray> field_list = statm.readAll().split(' ');
+	if(field_list.size() < 2) return 0;
+	return field_list[1].toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+
+/**
+ * Logs how much memory metadata takes up, and how much resident memory grew since start_memory was
+ * taken, so memory use of a library can be compared between builds. Only built when
+ * ECOMICS_MEMORY_STATS is defined.
+ */
+void Library::logMemoryUsage(const qint64 start_memory) const {
+	qint64 num_of_pages = 0;
+	qint64 metadata_size = 0;
+
+	// Only count details that are loaded, the rest are still in details store
+	for(const ComicFile &comic : *this) {
+		metadata_size += sizeof(ComicInfo);
+		if(!comic.info.isDetailsLoaded()) continue;
+
+		num_of_pages += comic.info.getPageList().size();
+		metadata_size += sizeof(ComicInfo::Details) +
+				comic.info.getPageList().capacity() * sizeof(Page);
+	}
+
+	qDebug() << "Metadata for" << size() << "comics and" << num_of_pages << "pages uses" <<
+		(metadata_size + StringPool::getMemoryUsage()) / 1024 << "KiB," <<
+		StringPool::getNumOfStrings() << "distinct values";
+	if(start_memory > 0) {
+		qDebug() << "Resident memory grew by" << (getResidentMemory() - start_memory) / 1024 <<
+			"KiB while loading library";
+	}
+}
+#endif
+
+
+/**
+ * Indexes every comic, if more than one comic has the same path or md5 hash then the first is
+ * indexed, same as a linear search would find.
+ */
+void Library::buildIndex() const {
+	path_index.clear();
+	md5_hash_index.clear();
+	path_index.reserve(size());
+	md5_hash_index.reserve(size());
+
+	// Backwards so that the first of any duplicates is inserted last
+	for(int i = size() - 1; i >= 0; i--) {
+		path_index.insert(at(i).getPath(), i);
+		if(!at(i).getMd5Hash().isEmpty()) md5_hash_index.insert(at(i).getMd5Hash(), i);
+	}
+
+	index_valid = true;
+}
+
+
+/**
+ * Connects comic library now holds to it's info, so edits to it are saved, copies given to library
+ * aren't connected (see ComicFile::operator =()), then tells comic it's in library.
+ */
+void Library::adoptComic(ComicFile &comic) {
+	comic.connectSignals();
+	emit comic.addedToLibrary();
+}
+
+
+/**
+ * Adds comic at i to index, only valid for comics appended to the end of library.
+ */
+void Library::indexComic(const int i) {
+	if(!index_valid) return;
+
+	const ComicFile &comic = at(i);
+	if(!path_index.contains(comic.getPath())) path_index.insert(comic.getPath(), i);
+	if(!comic.getMd5Hash().isEmpty() && !md5_hash_index.contains(comic.getMd5Hash())) {
+		md5_hash_index.insert(comic.getMd5Hash(), i);
+	}
+}
+
+
+/**
+ * Called when comics are moved around in library, or when a comic's path or md5 hash changes.
+ */
+void Library::invalidateIndex() {
+	index_valid = false;
+}
+
+
+/**
+ * Sets stat of each comic written by MetadataWriter, so they aren't seen as changed on next scan,
+ * along with the hash of the xml that's now in the file. md5 hash is left as is, since writing
+ * metadata doesn't change the comic's pages. Comics whose write failed have their xml hash cleared,
+ * so the next save isn't skipped.
+ */
+void Library::applyWrittenComics() {
+	if(written_comics.isEmpty()) return;
+
+	beginTransaction();
+
+	for(auto i = written_comics.constBegin(); i != written_comics.constEnd(); ++i) {
+		metadata_writer->forgetQueuedHash(i.key(), i.value().second);
+		if(!contains(i.key())) continue;
+
+		ComicFile &comic = (*this)[i.key()];
+		if(i.value().first.isNull()) {
+			comic.xml_hash.clear();
+		} else {
+			comic.file_stat	=	i.value().first;
+			comic.xml_hash	=	i.value().second;
+		}
+		onChanged();
+	}
+
+	written_comics.clear();
+	commit();
+}
+
+
+/**
+ * Marks library as needing to be saved and changed() as needing to be emitted, which happens right
+ * away unless a transaction is open.
+ */
+void Library::onChanged() {
+	dirty			=	true;
+	notify_pending	=	true;
+
+	if(transaction_depth == 0) commit();
+}
+
+
+/**
+ * Appends comics imported by ScanPipeline, called by the pipeline's commit thread with a blocking
+ * queued connection. The gui thread reads library all the time, so it's only changed from there,
+ * and comics are copied here so they (and their ComicInfo) belong to the gui thread, rather than
+ * to a commit thread that's gone once the scan finishes. The commit thread waits, so batch stays
+ * valid until this returns.
+ */
+void Library::appendBatch(const QList<ComicFile *> &batch) {
+	QList<ComicFile> comic_list;
+	for(ComicFile *comic : batch) {
+		comic_list << *comic;
+		qDebug() << "Added to library:" << comic->getPath() << "\n";
+	}
+
+	append(comic_list);
+}
+
+
+/**
+ * Queued metadata write to path landed, if worker is busy then the new stat and xml hash are held
+ * until it's finished, since the worker may be modifying library.
+ */
+void Library::onMetadataWritten(const QString &path, const FileStat &file_stat,
+		const QByteArray &xml_hash) {
+	written_comics.insert(path, qMakePair(file_stat, xml_hash));
+	if(!thread->isRunning()) applyWrittenComics();
+}
+
+
+void Library::onMetadataFailed(const QString &path) {
+	onMetadataWritten(path, FileStat(), QByteArray());
+}
+
+
+/**
+ * Records cover hashes of thumbnails generated since last called, saving library once. If worker is
+ * busy then they're left in ThumbnailService until it's finished, since the worker may be modifying
+ * library, comics still find their thumbnail through ThumbnailService until then.
+ */
+void Library::applyCoverHashes() {
+	if(thread->isRunning()) return;
+
+	QHash<QByteArray, QByteArray> cover_hashes = thumbnail_service->takeCoverHashes();
+	if(cover_hashes.isEmpty()) return;
+
+	// Thumbnails don't change what's listed, so view isn't notified
+	beginTransaction();
+
+	for(auto i = cover_hashes.constBegin(); i != cover_hashes.constEnd(); ++i) {
+		if(!contains(i.key())) continue;
+
+		(*this)[i.key()].cover_hash = i.value();
+		dirty = true;
+	}
+
+	commit();
+}
+
+
+/**
+ * Adds or replaces comics read by LibraryWorker::updatePaths(), then runs anything that was queued
+ * while worker was busy.
+ */
+void Library::onWorkerFinished() {
+	disconnect(thread, SIGNAL(started()), worker, SLOT(updatePaths()));
+
+	if(!worker->updated_list.isEmpty()) {
+		beginTransaction();
+
+		for(const ComicFile &comic : worker->updated_list) {
+			int i = indexOf(comic.getPath());
+			if(i == -1) {
+				append(comic);
+				qDebug() << "Added to library:" << comic.getPath();
+			} else {
+				replace(i, comic);
+				qDebug() << "Updated in library:" << comic.getPath();
+			}
+		}
+
+		worker->updated_list.clear();
+		commit();
+	}
+
+	applyWrittenComics();
+	applyCoverHashes();
+
+	if(rescan_pending) {
+		rescan_pending = false;
+		scanDirectories();
+	}
+
+	if(cleanup_pending) {
+		cleanup_pending = false;
+		cleanupFiles();
+	}
+
+	if(!pending_renamed_paths.isEmpty() || !pending_removed_paths.isEmpty() ||
+			!pending_changed_paths.isEmpty()) {
+		QList<QPair<QString, QString>> renamed_paths = pending_renamed_paths;
+		QStringList removed_paths = pending_removed_paths;
+		QStringList changed_paths = pending_changed_paths;
+		pending_renamed_paths.clear();
+		pending_removed_paths.clear();
+		pending_changed_paths.clear();
+		updatePaths(renamed_paths, removed_paths, changed_paths);
+	}
+}
+
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  *								LIBRARYWORKER PRIVATE METHODS 									 *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
@@ -753,6 +1172,12 @@ void LibraryWorker::loadLibrary() {
 	qDebug() << "Loading library...";
 
 	QFile *file = library->file;
+	bool modified = false;
+#ifdef ECOMICS_MEMORY_STATS
+	qint64 start_memory = library->getResidentMemory();
+#endif
+
+	library->beginTransaction();
 
 	try {
 		// Open file for reading
@@ -780,14 +1205,35 @@ void LibraryWorker::loadLibrary() {
 						file->fileName(), &reader);
 			}
 
+			// Details file this library.xml was written with, libraries from before details files
+			// had generations don't name it and use library-details.dat
+			if(reader.name() == "Library") {
+				const QStringRef details_name = reader.attributes().value("Details");
+				if(!details_name.isEmpty()) {
+					DetailsStore::setPath(config->getRootDir().filePath(details_name.toString()));
+				}
+			}
+
+			// Directory modification times from last scan
+			else if(reader.name() == "Directory") {
+				QXmlStreamAttributes attributes = reader.attributes();
+				library->dir_cache.insert(attributes.value("Path").toString(),
+					attributes.value("Modified").toString().toLongLong());
+			}
+
 			// Next, if at a <Comic> element, loop through it's metadata tags
-			if(reader.name() == "Comic") {
+			else if(reader.name() == "Comic") {
 				// Start on first child of <Comic>
 				reader.readNextStartElement();
 
 				ComicInfo info;
 				QString comic_path;
 				QByteArray md5_hash;
+				QByteArray content_hash;
+				QByteArray xml_hash;
+				QByteArray cover_hash;
+				qint64 file_size = -1, modified_time = 0;
+				quint64 inode = 0;
 
 				// Loop through elements until </Comic> is found
 				while(!(reader.name() == "Comic" && reader.isEndElement())) {
@@ -799,8 +1245,9 @@ void LibraryWorker::loadLibrary() {
 					// If not end element for metadata tag, check if element is a valid MetadataTag
 					else if(!reader.isEndElement()) {
 						// Check if MetadataTag
-						if(!info[reader.name().toString()].isNull()) {
-							info[reader.name().toString()].setValue(reader.readElementText());
+						int tag_index = ComicInfo::indexOf(reader.name());
+						if(tag_index != -1) {
+							info.setValue(tag_index, reader.readElementText());
 						}
 
 						// Check if PageList
@@ -812,44 +1259,22 @@ void LibraryWorker::loadLibrary() {
 								// Even though <Page/> is a single self closing element, it will
 								// still recognize a closing </Page>, so we have to skip it
 								if(!reader.isEndElement()) {
-									QXmlStreamAttributes attributes = reader.attributes();
-									Page page(attributes.value("Image").toString());
-
-									// For the rest, if they are empty don't add them
-									if(attributes.hasAttribute("Type")) {
-										page.setType(attributes.value("Type").toString());
-									}
-
-									if(attributes.hasAttribute("DoublePage")) {
-										page.setDoublePage(
-												attributes.value("DoublePage").toString());
-									}
-
-									if(attributes.hasAttribute("ImageSize")) {
-										page.setImageSize(attributes.value("ImageSize").toString());
-									}
-
-									if(attributes.hasAttribute("Key")) {
-										page.setKey(attributes.value("Key").toString());
-									}
-
-									if(attributes.hasAttribute("ImageWidth")) {
-										page.setImageWidth(
-												attributes.value("ImageWidth").toString());
-									}
-
-									if(attributes.hasAttribute("ImageHeight")) {
-										page.setImageHeight(
-												attributes.value("ImageHeight").toString());
-									}
-
-									info.page_list << page;
+									info.editPageList() << Page::fromXml(reader.attributes());
 								}
 
 								reader.readNextStartElement();
 							}
 						}
 
+						// Check if details, which are left in details store until they're used
+						else if(reader.name() == "Details") {
+							QXmlStreamAttributes attributes = reader.attributes();
+							info.setDetailsId(DetailsStore::add({
+								attributes.value("Offset").toString().toLongLong(),
+								attributes.value("Size").toString().toInt()
+							}));
+						}
+
 						// Check if path
 						else if(reader.name() == "Path") {
 							comic_path = reader.readElementText();
@@ -859,16 +1284,42 @@ void LibraryWorker::loadLibrary() {
 						else if(reader.name() == "Md5Hash") {
 							md5_hash = reader.readElementText().toLocal8Bit();
 						}
+
+						// Check if content hash
+						else if(reader.name() == "ContentHash") {
+							content_hash = reader.readElementText().toLocal8Bit();
+						}
+
+						// Check if xml hash
+						else if(reader.name() == "XmlHash") {
+							xml_hash = reader.readElementText().toLocal8Bit();
+						}
+
+						// Check if cover hash
+						else if(reader.name() == "CoverHash") {
+							cover_hash = reader.readElementText().toLocal8Bit();
+						}
+
+						// Check if file stat
+						else if(reader.name() == "FileSize") {
+							file_size = reader.readElementText().toLongLong();
+						} else if(reader.name() == "Modified") {
+							modified_time = reader.readElementText().toLongLong();
+						} else if(reader.name() == "Inode") {
+							inode = reader.readElementText().toULongLong();
+						}
 					}
 
 					reader.readNextStartElement();
 				}
 
-				// Load ComicFile, setting it's ComicInfo to info loaded from library
-				ComicFile comic(comic_path, info, md5_hash);
+				// Load ComicFile, setting it's ComicInfo to info loaded from library, md5 hash is only
+				// regenerated if file has changed since last stat
+				ComicFile comic(comic_path, info, md5_hash, FileStat(file_size, modified_time, inode),
+						content_hash, xml_hash, cover_hash);
 
 				// If ComicFile was modified and has different md5_hash, then mark library dirty
-				if(comic.getMd5Hash() != md5_hash) library->dirty = true;
+				if(comic.getMd5Hash() != md5_hash) modified = true;
 
 				// Append ComicFile to library
 				(*library) << comic;
@@ -876,11 +1327,15 @@ void LibraryWorker::loadLibrary() {
 		}
 
 		file->close();
-
-		// If any comics are different from what was loaded, then re-save library
-		if(library->dirty) library->save();
 	} catch(const eComics::Exception &e) { e.printMsg(); }
 
+	// Only re-save library if any comics are different from what was loaded
+	library->dirty = modified;
+	library->commit();
+#ifdef ECOMICS_MEMORY_STATS
+	library->logMemoryUsage(start_memory);
+#endif
+
 	emit library->finishedWorker(tr("Finished loading library"));
 }
 
@@ -888,85 +1343,239 @@ void LibraryWorker::loadLibrary() {
 /**
  * Scans Comic and/or Manga directories defined in Config object, adding/removing comics/manga from
  * library as needed. save() will automatically be called after this.
+ *
+ * The scan is incremental, comics already in library are only stat'd, and are only re-read if their
+ * size, modification time, or inode changed. Directories whose modification time hasn't changed
+ * since the last scan can't contain any new files, so they aren't listed, only their known
+ * subdirectories are descended into.
  */
 void LibraryWorker::scanDirectories() {
 	emit library->startedWorker(tr("Scanning directories..."));
 	qDebug() << "Scanning directories for changes...";
 
-	// First scan library for non-existent comics, and remove them
-	for(int i = 0; i < library->size(); i++) {
-		if(!QFile::exists((*library)[i].getPath())) {
-			library->removeAt(i);
-		}
-	}
+	QSet<QString> known_paths;
+	QSet<QString> missing_paths;
+	QStringList changed_paths;
+	QList<QPair<QString, QString>> moved_paths; // Old and new path of comics moved/renamed on disk
 
-	// Next scan comic and/or manga directories to add any new comics/manga
-	QDirIterator *cur = nullptr;
+	// Everything below is saved, and the view notified, once at the end
+	library->beginTransaction();
 
-	// 2x loop, once for comics, another for manga
-	for(int count = 1; count <= 2; count++) {
-		// On first iteration set cur to comic dir if it's enabled, on second do manga
-		switch(count) {
-			case 1:
-				if(config->isComicEnabled()) {
-					cur = new QDirIterator(config->getComicDir(), QDirIterator::Subdirectories);
-				} else {
-					continue;
-				}
-				break;
+	// First stat comics in library, noting non-existent comics and modified ones
+	for(const ComicFile &comic : *library) {
+		FileStat file_stat = FileStat::fromPath(comic.getPath());
 
-			case 2:
-				if(config->isMangaEnabled()) {
-					cur = new QDirIterator(config->getMangaDir(), QDirIterator::Subdirectories);
-				} else {
-					goto done_scanning;
-				}
+		if(!file_stat.isFile()) {
+			missing_paths.insert(comic.getPath());
+			continue;
 		}
 
-		// Loop through current directory iterator getting comics
-		while(cur->hasNext()) {
-			cur->next();
+		known_paths.insert(comic.getPath());
+		if(file_stat != comic.getFileStat()) changed_paths << comic.getPath();
+	}
 
-			// If not a file, skip
-			if(!cur->fileInfo().isFile()) continue;
+	// Comics that are missing may have just been moved or renamed, so index them by stat to match
+	// them with files found by walk. A moved file keeps it's size and modification time (and inode
+	// on the same filesystem), so a match is made on all three, or if the inode differs (moved
+	// across filesystems) on size and modification time along with the file's md5 hash. md5 hash
+	// is kept here since library may be appended to while walking
+	struct Missing {
+		QString path;
+		quint64 inode;
+		QByteArray md5_hash;
+	};
+
+	QHash<QPair<qint64, qint64>, QList<Missing>> missing_index;
+	for(const QString &path : missing_paths) {
+		const ComicFile &comic = library->at(path);
+		const FileStat file_stat = comic.getFileStat();
+		if(!file_stat.isNull()) {
+			missing_index[qMakePair(file_stat.getSize(), file_stat.getModified())] <<
+				Missing{path, file_stat.getInode(), comic.getMd5Hash()};
+		}
+	}
 
-			ComicFile cur_file(cur->filePath());
+	const bool check_moved = !missing_index.isEmpty();
 
-			// First check if file is valid
-			if(cur_file.isNull()) {
-				continue;
-			}
+	// Map each cached directory to it's cached subdirectories
+	const QHash<QString, qint64> old_cache = library->dir_cache;
+	QHash<QString, QStringList> subdirs;
+	for(auto iter = old_cache.constBegin(); iter != old_cache.constEnd(); ++iter) {
+		subdirs[iter.key().left(iter.key().lastIndexOf('/'))] << iter.key();
+	}
 
-			// Next check if file at path already exists in library
-			if(library->contains(cur->filePath())) {
-				// If it exists in library, check if it's been modified by comparing the md5 hash
-				if(library->at(cur->filePath()).getMd5Hash() == cur_file.getMd5Hash()) {
-					continue;
-				} else {
-					// If file has been modified, then remove from library to re-add
-					library->removeAt(library->indexOf(cur->filePath()));
+	// Next walk comic and/or manga directories for new comics/manga, a directory whose modification
+	// time hasn't changed can't contain any new files, so it's not read, only it's known
+	// subdirectories are walked
+	QStringList root_list;
+	if(config->isComicEnabled()) root_list << config->getComicPath();
+	if(config->isMangaEnabled()) root_list << config->getMangaPath();
+
+	// New comics are imported by the pipeline while the walk is still going, each batch is handed
+	// from the pipeline's commit thread to library's thread to be added
+	ScanPipeline pipeline([](const QList<ComicFile *> &batch) {
+		// Appended from library's own thread, see Library::appendBatch()
+		QMetaObject::invokeMethod(library, "appendBatch", Qt::BlockingQueuedConnection,
+				Q_ARG(QList<ComicFile *>, batch));
+	});
+
+	QMutex mutex; // Walker callbacks run on several threads
+	QHash<QString, qint64> new_cache;
+	const QSet<QString> &const_known_paths = known_paths;
+
+	DirWalker walker;
+	walker.onDirectory = [&](const QString &dir_path, const FileStat &dir_stat,
+			QStringList &dir_subdirs) {
+		bool unchanged = (old_cache.value(dir_path, -1) == dir_stat.getModified());
+		QMutexLocker locker(&mutex);
+		new_cache.insert(dir_path, dir_stat.getModified());
+		if(unchanged) dir_subdirs = subdirs.value(dir_path);
+		return !unchanged;
+	};
+	walker.onFile = [&](const QString &file_path, const FileStat &file_stat) {
+		if(const_known_paths.contains(file_path)) return;
+
+		if(check_moved) {
+			const QPair<qint64, qint64> key(file_stat.getSize(), file_stat.getModified());
+
+			// Relinks file to the missing comic with the same inode, or the same md5 hash if one is
+			// given, returns true if relinked
+			auto relink = [&](const QByteArray &md5_hash) -> bool {
+				QMutexLocker locker(&mutex);
+				auto iter = missing_index.find(key);
+				if(iter == missing_index.end()) return false;
+
+				QList<Missing> &candidates = iter.value();
+				for(int i = 0; i < candidates.size(); i++) {
+					if(md5_hash.isEmpty() ? (candidates[i].inode == file_stat.getInode()) :
+							(candidates[i].md5_hash == md5_hash)) {
+						moved_paths << qMakePair(candidates.takeAt(i).path, file_path);
+						if(candidates.isEmpty()) missing_index.erase(iter);
+						return true;
+					}
 				}
+
+				return false;
+			};
+
+			bool has_candidates;
+			{
+				QMutexLocker locker(&mutex);
+				has_candidates = missing_index.contains(key);
 			}
 
-			// Last add it to library and set dirty to true
-			(*library) << cur_file;
-			library->dirty = true;
+			if(has_candidates) {
+				if(relink(QByteArray())) return;
+
+				// Different inode, so only relink if it's really the same file, md5 hash is read
+				// outside lock since it reads the whole file
+				QByteArray md5_hash;
+				try {
+					md5_hash = ComicFile::generateMd5Hash(file_path);
+				} catch(const eComics::Exception &e) {
+					e.printMsg();
+				}
 
-			// Update debug log
-			qDebug() << "Added to library:" << cur->filePath() << "\n";
+				if(!md5_hash.isEmpty() && relink(md5_hash)) return;
+			}
 		}
 
-		// Reset cur
-		delete cur;
-		cur = nullptr;
+		pipeline.push(file_path, file_stat);
+	};
+
+	QElapsedTimer timer;
+	timer.start();
+	walker.walk(root_list);
+	qDebug() << "Walked" << walker.getNumOfDirs() << "directories and" <<
+		walker.getNumOfFiles() << "files in" << timer.elapsed() << "ms";
+	pipeline.finish();
+	qDebug() << "Imported" << pipeline.getNumOfComics() << "comics in" << timer.elapsed() << "ms";
+
+	library->dir_cache = new_cache;
+	if(library->dir_cache != old_cache) library->dirty = true;
+
+	// Relink moved comics, keeping their metadata, thumbnail, and list membership, look up every
+	// index first since changing a path invalidates index
+	QList<int> moved_index_list;
+	for(const QPair<QString, QString> &pair : moved_paths) {
+		moved_index_list << library->indexOf(pair.first);
+		missing_paths.remove(pair.first);
+	}
+
+	for(int i = 0; i < moved_paths.size(); i++) {
+		(*library)[moved_index_list[i]].setPath(moved_paths[i].second);
+		library->dirty = library->notify_pending = true;
+		qDebug() << "Moved in library:" << moved_paths[i].first << "->" << moved_paths[i].second;
 	}
 
-	done_scanning:
-		if(library->dirty) try {
-			library->save();
-		} catch(const eComics::Exception &e) {
-			e.printMsg();
+	// Remove comics that are really gone all at once
+	library->removePaths(missing_paths);
+	missing_paths.clear();
+
+	// Re-read modified comics, ComicFile checks library itself to see if md5 hash actually changed,
+	// if only it's metadata changed (content hash is the same) then just the metadata is reloaded
+	for(const QString &path : changed_paths) {
+		ComicFile cur_file(path);
+		if(cur_file.isNull()) {
+			missing_paths.insert(path);
+			continue;
 		}
 
+		library->replace(library->indexOf(path), cur_file);
+		qDebug() << "Updated in library:" << path << "\n";
+	}
+
+	library->removePaths(missing_paths);
+	library->commit();
+
 	emit library->finishedWorker(tr("Finished scanning directories"));
+}
+
+
+/**
+ * Walks comic and/or manga directories, and deletes any empty folders, deepest first so that
+ * folders which only contained empty folders are deleted as well.
+ */
+void LibraryWorker::deleteEmptyDirs() {
+	emit library->startedWorker(tr("Deleting empty folders..."));
+
+	QStringList root_list;
+	if(config->isComicEnabled()) root_list << config->getComicPath();
+	if(config->isMangaEnabled()) root_list << config->getMangaPath();
+
+	QMutex mutex;
+	QStringList dir_list;
+	DirWalker walker;
+	walker.onDirectory = [&](const QString &dir_path, const FileStat &, QStringList &) {
+		QMutexLocker locker(&mutex);
+		dir_list << dir_path;
+		return true;
+	};
+	walker.walk(root_list);
+
+	std::sort(dir_list.begin(), dir_list.end(), [](const QString &lhs, const QString &rhs) {
+		return lhs.count('/') > rhs.count('/');
+	});
+
+	for(const QString &dir_path : dir_list) {
+		// Never delete comic or manga dir itself, rmdir() fails on folders that aren't empty
+		if(root_list.contains(dir_path)) continue;
+		QDir().rmdir(dir_path);
+	}
+
+	emit library->finishedWorker(tr("Finished deleting empty folders"));
+}
+
+
+/**
+ * Reads each of paths as a ComicFile for Library::onWorkerFinished() to add to library.
+ */
+void LibraryWorker::updatePaths() {
+	for(const QString &path : paths) {
+		ComicFile comic(path);
+		if(!comic.isNull()) updated_list << comic;
+	}
+
+	paths.clear();
+	emit library->finishedWorker(tr("Finished updating library"));
 }
\ No newline at end of file
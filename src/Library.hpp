@@ -23,7 +23,11 @@
 
 #include <QDebug>
 #include <QDirIterator>
+#include <QHash>
+#include <QPair>
+#include <QSet>
 #include <QThread>
+#include <QTimer>
 
 #include "Actions.hpp"
 #include "ComicInfo.hpp"
@@ -47,6 +51,7 @@ class LibraryWorker;
 class Library : public QObject, public QList<ComicFile> {
 	Q_OBJECT
 
+	friend class ComicFile;
 	friend class LibraryWorker;
 
 
@@ -94,10 +99,13 @@ class Library : public QObject, public QList<ComicFile> {
 		void removeFirst();
 		void removeLast();
 		bool removeOne(const ComicFile &comic);
+		int removePaths(const QSet<QString> &path_set);
 		void replace(int i, const ComicFile &comic);
 		void save();
-		void startBatchEditing();
-		void finishBatchEditing();
+		void updatePaths(const QList<QPair<QString, QString>> &renamed_paths,
+			const QStringList &removed_paths, const QStringList &changed_paths);
+		void beginTransaction();
+		void commit();
 		using QList::at;
 		const ComicFile & at(const QByteArray &md5_hash) const;
 		const ComicFile & at(const QString &path) const;
@@ -114,6 +122,7 @@ class Library : public QObject, public QList<ComicFile> {
 	signals:
 		void startedWorker(const QString &msg);
 		void finishedWorker(const QString &msg);
+		void changed();
 
 	public slots:
 		void addComics();
@@ -122,17 +131,58 @@ class Library : public QObject, public QList<ComicFile> {
 		void removeSelectedComics();
 		void scanDirectories();
 
+	private slots:
+		void appendBatch(const QList<ComicFile *> &batch);
+		void onMetadataWritten(const QString &path, const FileStat &file_stat,
+				const QByteArray &xml_hash);
+		void onMetadataFailed(const QString &path);
+		void applyCoverHashes();
+		void onWorkerFinished();
+
 	private:
+		static const int COVER_DELAY = 3000; // Milliseconds to wait for more thumbnails
 		static Library *instance;
 		static LibraryWorker *worker;
 		QThread *thread;
 		QFile *file;
+		QHash<QString, qint64> dir_cache; // Modification time of each scanned directory
 		ComicFile null;
-		bool dirty			=	false;
-		bool batch_editing	=	false;
+		bool dirty				=	false;
+		bool notify_pending		=	false; // changed() will be emitted by commit()
+		int transaction_depth	=	0;
+		bool rescan_pending		=	false; // scanDirectories() was called while worker was busy
+		bool cleanup_pending	=	false; // cleanupFiles() was called while worker was busy
+
+		// Index of first comic with each path/md5 hash, rebuilt on lookup after being invalidated
+		mutable QHash<QString, int> path_index;
+		mutable QHash<QByteArray, int> md5_hash_index;
+		mutable bool index_valid = false;
+
+		// Changes from LibraryWatcher that arrived while worker was busy
+		QList<QPair<QString, QString>> pending_renamed_paths;
+		QStringList pending_removed_paths;
+		QStringList pending_changed_paths;
+
+		// New stat and xml hash of comics written by MetadataWriter (null stat if write failed),
+		// applied once worker is idle
+		QHash<QString, QPair<FileStat, QByteArray>> written_comics;
+
+		// Cover hashes of thumbnails generated by ThumbnailService are recorded in batches, so a
+		// backfill doesn't save library once per thumbnail
+		QTimer cover_timer;
 
 		Library();
 		~Library();
+#ifdef ECOMICS_MEMORY_STATS
+		static qint64 getResidentMemory();
+		void logMemoryUsage(const qint64 start_memory) const;
+#endif
+		void buildIndex() const;
+		void adoptComic(ComicFile &comic);
+		void indexComic(const int i);
+		void invalidateIndex();
+		void applyWrittenComics();
+		void onChanged();
 };
 
 extern Library *library;
@@ -147,9 +197,15 @@ class LibraryWorker : public QObject {
 
 	friend class Library;
 
+	private:
+		QStringList paths; // Paths for updatePaths() to read
+		QList<ComicFile> updated_list; // Comics read by updatePaths(), applied by Library
+
 	private slots:
 		void loadLibrary();
 		void scanDirectories();
+		void deleteEmptyDirs();
+		void updatePaths();
 };
 
 
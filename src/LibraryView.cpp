@@ -1,15 +1,21 @@
 #include "LibraryView.hpp"
 
+#include <algorithm>
+#include <QCryptographicHash>
 #include <QDesktopServices>
 #include <QMimeData>
 #include <QPainter>
+#include <QScrollBar>
+#include <QTimer>
 #include <QUrl>
 
 #include "Actions.hpp"
 #include "ComicFile.hpp"
 #include "Config.hpp"
+#include "ImageScaler.hpp"
 #include "Library.hpp"
 #include "MainSidePane.hpp"
+#include "ThumbnailService.hpp"
 #include "ToolBar.hpp"
 
 
@@ -65,6 +71,13 @@ ReferenceList<ComicFile> LibraryView::getSelectedComics() {
 }
 
 
+int LibraryView::getZoom() const {
+	int zoom = 0;
+	while((ThumbnailService::MIN_ICON_SIZE << zoom) < icon_size) zoom++;
+	return zoom;
+}
+
+
 /**
  * Resets scope to top level.
  */
@@ -89,12 +102,20 @@ void LibraryView::resetScope() {
 	model->cur_scope.volume.clear();
 	model->cur_scope.user_list.clear();
 
-	refreshModel();
+	model->refreshList();
+	QTimer::singleShot(0, this, SLOT(requestVisibleThumbs()));
 }
 
 
+/**
+ * Brings model up to date with library, only rows that changed are touched, so selection and
+ * scroll position are kept.
+ */
 void LibraryView::refreshModel() {
-	model->refreshList();
+	model->updateList();
+
+	// Items are laid out later, so wait until then to find which are visible
+	QTimer::singleShot(0, this, SLOT(requestVisibleThumbs()));
 }
 
 
@@ -117,6 +138,70 @@ void LibraryView::onItemActivated(const QModelIndex &index) {
 
 void LibraryView::onNavigateBack() {
 	model->navigateBack();
+	QTimer::singleShot(0, this, SLOT(requestVisibleThumbs()));
+}
+
+
+/**
+ * Pass thumbReady signal from ThumbnailService to nested LibraryModel class.
+ */
+void LibraryView::onThumbReady(const QByteArray &md5_hash) {
+	model->onThumbReady(md5_hash);
+}
+
+
+/**
+ * Moves thumbnails of items that are on screen to the front of ThumbnailService's queue. The next
+ * screen in the direction being scrolled is prefetched (half a screen each way when not scrolling),
+ * so it's covers are generated and loaded by the time they're shown.
+ */
+void LibraryView::requestVisibleThumbs() {
+	QRect viewport_rect = viewport()->rect();
+	QPair<int, int> visible_rows = rowsInRect(viewport_rect);
+	for(int row = visible_rows.first; row <= visible_rows.second; row++) {
+		model->requestThumbs(row, ThumbnailService::HIGH_PRIORITY);
+	}
+
+	int scroll_value = verticalScrollBar()->value();
+	int height = viewport_rect.height();
+	QRect ahead_rect;
+	if(scroll_value > last_scroll_value) ahead_rect = viewport_rect.translated(0, height);
+	else if(scroll_value < last_scroll_value) ahead_rect = viewport_rect.translated(0, -height);
+	else ahead_rect = viewport_rect.adjusted(0, -height / 2, 0, height / 2);
+	last_scroll_value = scroll_value;
+
+	QPair<int, int> ahead_rows = rowsInRect(ahead_rect);
+	for(int row = ahead_rows.first; row <= ahead_rows.second; row++) {
+		if(row < visible_rows.first || row > visible_rows.second) {
+			model->requestThumbs(row, ThumbnailService::NORMAL_PRIORITY);
+		}
+	}
+
+	model->prefetchRows(ahead_rows.first, ahead_rows.second);
+	prefetch_timer.start();
+}
+
+
+/**
+ * Sets icon size to one of the sizes ThumbnailService stores, from 0 (MIN_ICON_SIZE) to MAX_ZOOM
+ * (MAX_ICON_SIZE), so thumbnails are shown as stored instead of being rescaled on every paint, and
+ * small zoom levels read less of the thumbnail store.
+ */
+void LibraryView::setZoom(int zoom) {
+	zoom		=	qBound(0, zoom, MAX_ZOOM);
+	icon_size	=	ThumbnailService::MIN_ICON_SIZE << zoom;
+	setIconSize(QSize(icon_size, icon_size));
+
+	// Every item gets the same cell, so laying out never asks the model for sizes
+	setGridSize(QSize(icon_size + SPACING * 2,
+		icon_size + SPACING + fontMetrics().lineSpacing() * NUM_OF_TEXT_LINES));
+
+	// Placeholder has the proportions of a typical cover
+	placeholder = QPixmap(icon_size * 2 / 3, icon_size);
+	placeholder.fill(palette().color(QPalette::Mid));
+
+	// Items are laid out again later, so wait until then to find which are visible
+	QTimer::singleShot(0, this, SLOT(requestVisibleThumbs()));
 }
 
 
@@ -126,19 +211,42 @@ void LibraryView::onNavigateBack() {
 
 
 LibraryView::LibraryView(QWidget *parent) : QListView(parent) {
-	icon_size = 256;
 	LibraryModel::init(this);
 	setModel(model);
 	setSelectionMode(ExtendedSelection);
 	setViewMode(QListView::IconMode);
-	setIconSize(QSize(icon_size, icon_size));
-	setSpacing(15);
+	setZoom(MAX_ZOOM);
+	setSpacing(SPACING);
 	setResizeMode(Adjust);
+
+	// Large scopes are laid out in batches between events, so the view stays responsive
+	setUniformItemSizes(true);
+	setLayoutMode(Batched);
+	setBatchSize(BATCH_SIZE);
+
 	connect(eComics::actions->navigateBack(), SIGNAL(triggered()), this, SLOT(onNavigateBack()));
 	connect(main_side_pane, SIGNAL(selectedListChanged(const QString &)),
 		this, SLOT(onListChanged(const QString &)));
 	connect(this, SIGNAL(activated(const QModelIndex &)),
 		this, SLOT(onItemActivated(const QModelIndex &)));
+	connect(library, SIGNAL(changed()), this, SLOT(refreshModel()));
+	connect(thumbnail_service, SIGNAL(thumbReady(const QByteArray &)),
+		this, SLOT(onThumbReady(const QByteArray &)));
+	connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(requestVisibleThumbs()));
+
+	// Prefetch in small batches between events, so scrolling isn't held up by it
+	prefetch_timer.setInterval(0);
+	connect(&prefetch_timer, SIGNAL(timeout()), this, SLOT(prefetchNext()));
+
+	// Prefetch scope of group that's hovered or made current, in case it's opened next
+	setMouseTracking(true);
+	hover_timer.setSingleShot(true);
+	hover_timer.setInterval(HOVER_DELAY);
+	connect(&hover_timer, SIGNAL(timeout()), this, SLOT(prefetchHoveredScope()));
+	connect(this, SIGNAL(entered(const QModelIndex &)),
+		this, SLOT(onItemHovered(const QModelIndex &)));
+	connect(selectionModel(), SIGNAL(currentChanged(const QModelIndex &, const QModelIndex &)),
+		this, SLOT(onCurrentChanged(const QModelIndex &, const QModelIndex &)));
 	connect(
 		selectionModel(), SIGNAL(selectionChanged(const QItemSelection &, const QItemSelection &)),
 		this, SLOT(onSelectionChanged(const QItemSelection &, const QItemSelection &))
@@ -170,6 +278,46 @@ LibraryView::~LibraryView() {
 }
 
 
+/**
+ * Returns first and last row of items intersecting rect (last is before first if there are none).
+ * Rows are laid out in order, left to right then top to bottom, so both ends are found with a
+ * binary search, rather than checking every item. Items that aren't laid out yet count as below
+ * rect.
+ */
+QPair<int, int> LibraryView::rowsInRect(const QRect &rect) const {
+	int low = 0, high = model->rowCount();
+	while(low < high) {
+		int mid = (low + high) / 2;
+		QRect item_rect = visualRect(model->index(mid, 0));
+		if(!item_rect.isEmpty() && item_rect.bottom() < rect.top()) low = mid + 1;
+		else high = mid;
+	}
+
+	int first = low;
+	high = model->rowCount();
+	while(low < high) {
+		int mid = (low + high) / 2;
+		QRect item_rect = visualRect(model->index(mid, 0));
+		if(!item_rect.isEmpty() && item_rect.top() <= rect.bottom()) low = mid + 1;
+		else high = mid;
+	}
+
+	return QPair<int, int>(first, low - 1);
+}
+
+
+/**
+ * Returns how many items fit on screen, counting a partly shown row.
+ */
+int LibraryView::getItemsPerScreen() const {
+	QSize grid_size = gridSize();
+	if(grid_size.isEmpty()) return 0;
+
+	int columns = qMax(1, viewport()->width() / grid_size.width());
+	return columns * (viewport()->height() / grid_size.height() + 1);
+}
+
+
 void LibraryView::onSelectionChanged(const QItemSelection &selected,
 		const QItemSelection &deselected) {
 	if(selected.size() == 0) {
@@ -192,6 +340,34 @@ void LibraryView::onSelectionChanged(const QItemSelection &selected,
 }
 
 
+void LibraryView::onCurrentChanged(const QModelIndex &current, const QModelIndex &) {
+	onItemHovered(current);
+}
+
+
+/**
+ * Prefetching waits until index has been hovered (or current) for HOVER_DELAY, so just moving the
+ * mouse across the view doesn't build every scope it passes.
+ */
+void LibraryView::onItemHovered(const QModelIndex &index) {
+	if(!index.isValid() || model->isTopLevelScope()) return;
+	hovered_index = index;
+	hover_timer.start();
+}
+
+
+void LibraryView::prefetchHoveredScope() {
+	if(!hovered_index.isValid() || model->isTopLevelScope()) return;
+	model->prefetchScope(hovered_index.row(), getItemsPerScreen());
+	prefetch_timer.start();
+}
+
+
+void LibraryView::prefetchNext() {
+	if(!model->prefetchNext(PREFETCH_BATCH)) prefetch_timer.stop();
+}
+
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  *									LIBRARYMODEL PUBLIC METHODS 								 *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
@@ -216,26 +392,19 @@ QVariant LibraryView::LibraryModel::data(const QModelIndex &index, int role) con
 
 	if(role == Qt::DecorationRole) {
 		switch(cur_scope.category) {
-			case PUBLISHER_SCOPE: {
-				QList<ComicFile> comic_list = library->getComicsFromPublisher(list.at(index.row()));
-				return layeredIcon(comic_list);
-			}
-
-			case SERIES_SCOPE: {
-				QList<ComicFile> comic_list = library->getComicsFromSeries(list.at(index.row()),
-					(config->groupByPublisher()) ? cur_scope.publisher : 0);
-				return layeredIcon(comic_list);
-			}
-
-			case VOLUME_SCOPE: {
-				QList<ComicFile> comic_list = library->getComicsFromVolume(cur_scope.series,
-					list.at(index.row()), (config->groupByPublisher()) ? cur_scope.publisher : 0);
-				return layeredIcon(comic_list);
-			}
+			case PUBLISHER_SCOPE:
+			case SERIES_SCOPE:
+			case VOLUME_SCOPE:
+				return groupIcon(getGroupCovers(index.row()));
 
 			case TITLE_SCOPE: {
-				ComicFile comic = library->at(list.at(index.row()).toLocal8Bit());
-				return QIcon(comic.getThumbPath());
+				// Show placeholder until thumbnail is ready, then onThumbReady() updates item
+				const ComicFile &comic = library->at(list.at(index.row()).toLocal8Bit());
+				QPixmap thumb = getThumbPixmap(comic);
+				if(!thumb.isNull()) return QIcon(thumb);
+
+				thumbnail_service->request(comic, ThumbnailService::NORMAL_PRIORITY);
+				return QIcon(library_view->placeholder);
 			}
 
 			default:
@@ -254,7 +423,7 @@ QVariant LibraryView::LibraryModel::data(const QModelIndex &index, int role) con
 
 			case TITLE_SCOPE:
 			case LIST_SCOPE: {
-				ComicInfo info = library->at(list.at(index.row()).toLocal8Bit()).info;
+				const ComicInfo &info = library->at(list.at(index.row()).toLocal8Bit()).info;
 
 				if(!info.getSeries().isEmpty()) str.append(info.getSeries());
 				if(!str.isEmpty()) str.append("\n");
@@ -306,7 +475,7 @@ QMimeData * LibraryView::LibraryModel::mimeData(const QModelIndexList &index_lis
 			switch(cur_scope.category) {
 				case PUBLISHER_SCOPE:
 					comic_list = library->getComicsFromPublisher(str);
-					for(ComicFile comic : comic_list) {
+					for(const ComicFile &comic : comic_list) {
 						url_list << QUrl(QString("file://") +
 							comic.getPath().toLocal8Bit().toPercentEncoding("/"));
 					}
@@ -314,7 +483,7 @@ QMimeData * LibraryView::LibraryModel::mimeData(const QModelIndexList &index_lis
 
 				case SERIES_SCOPE:
 					comic_list = library->getComicsFromSeries(str, cur_scope.publisher);
-					for(ComicFile comic : comic_list) {
+					for(const ComicFile &comic : comic_list) {
 						url_list << QUrl(QString("file://") +
 							comic.getPath().toLocal8Bit().toPercentEncoding("/"));
 					}
@@ -324,7 +493,7 @@ QMimeData * LibraryView::LibraryModel::mimeData(const QModelIndexList &index_lis
 					comic_list = library->getComicsFromVolume(
 						cur_scope.series, str, cur_scope.publisher
 					);
-					for(ComicFile comic : comic_list) {
+					for(const ComicFile &comic : comic_list) {
 						url_list << QUrl(QString("file://") +
 							comic.getPath().toLocal8Bit().toPercentEncoding("/"));
 					}
@@ -353,59 +522,17 @@ int LibraryView::LibraryModel::rowCount(const QModelIndex &parent) const {
 
 
 /**
- * Populate internal list of LibraryModel to be displayed in LibraryView.
+ * Repopulates internal list of LibraryModel for a new scope, and selects the first item.
  */
 void LibraryView::LibraryModel::refreshList() {
-	emit layoutAboutToBeChanged();
-	list.clear();
-
-	for(ComicFile comic : *library) {
-		// Skip comics that are not part of selected library
-		if(cur_scope.library != "All" &&
-			!(comic.info.getManga() == "Yes" && cur_scope.library == "Manga") &&
-			!(comic.info.getManga() == "No" && cur_scope.library == "Comics") &&
-			cur_scope.user_list.isEmpty()) continue;
-
-		switch(cur_scope.category) {
-			case PUBLISHER_SCOPE:
-				if(!list.contains(comic.info.getPublisher())) {
-					list.append(comic.info.getPublisher());
-				}
-				break;
-
-			case SERIES_SCOPE:
-				if((cur_scope.publisher == comic.info.getPublisher() ||
-						cur_scope.publisher == "All") && !list.contains(comic.info.getSeries())) {
-					list.append(comic.info.getSeries());
-				}
-				break;
+	Rows rows = buildRows(cur_scope);
 
-			case VOLUME_SCOPE:
-				if((cur_scope.publisher == comic.info.getPublisher() ||
-						cur_scope.publisher == "All") &&
-						cur_scope.series == comic.info.getSeries() &&
-						!list.contains(comic.info.getVolume())) {
-					list.append(comic.info.getVolume());
-				}
-				break;
-
-			case TITLE_SCOPE:
-				if((cur_scope.publisher == comic.info.getPublisher() ||
-						cur_scope.publisher == "All") &&
-						cur_scope.series == comic.info.getSeries() &&
-						cur_scope.volume == comic.info.getVolume()) {
-					list.append(comic.getMd5Hash());
-				}
-				break;
-
-			case LIST_SCOPE:
-				//TODO: PARSE USER-MADE LIST TO ADD COMICS
-				break;
-		}
-	}
-
-	qSort(list);
-	emit layoutChanged();
+	beginResetModel();
+	list			=	rows.list;
+	group_covers	=	rows.group_covers;
+	signatures		=	rows.signatures;
+	endResetModel();
+	child_items.clear();
 
 	// Update ToolBar by enabling/disabling back button
 	if(cur_scope.category == PUBLISHER_SCOPE || cur_scope.category == LIST_SCOPE ||
@@ -418,6 +545,53 @@ void LibraryView::LibraryModel::refreshList() {
 }
 
 
+/**
+ * Updates internal list after library changed, keeping scope. Old and new lists are both sorted,
+ * so they're walked side by side, removing and inserting runs of rows where they differ, and
+ * updating rows whose signature changed.
+ */
+void LibraryView::LibraryModel::updateList() {
+	Rows rows = buildRows(cur_scope);
+	const QStringList &new_list = rows.list;
+	group_covers = rows.group_covers;
+	child_items.clear();
+
+	int row = 0, i = 0;
+	while(row < list.size() || i < new_list.size()) {
+		if(i == new_list.size() || (row < list.size() && list.at(row) < new_list.at(i))) {
+			int last = row;
+			while(last + 1 < list.size() &&
+					(i == new_list.size() || list.at(last + 1) < new_list.at(i))) {
+				last++;
+			}
+
+			beginRemoveRows(QModelIndex(), row, last);
+			list.erase(list.begin() + row, list.begin() + last + 1);
+			endRemoveRows();
+		} else if(row == list.size() || new_list.at(i) < list.at(row)) {
+			int last = i;
+			while(last + 1 < new_list.size() &&
+					(row == list.size() || new_list.at(last + 1) < list.at(row))) {
+				last++;
+			}
+
+			beginInsertRows(QModelIndex(), row, row + last - i);
+			for(; i <= last; i++) list.insert(row++, new_list.at(i));
+			endInsertRows();
+		} else {
+			if(signatures.value(list.at(row)) != rows.signatures.value(list.at(row))) {
+				emit dataChanged(index(row, 0), index(row, 0));
+			}
+
+			row++;
+			i++;
+		}
+	}
+
+	signatures = rows.signatures;
+}
+
+
 void LibraryView::LibraryModel::setSelectedLibrary(const QString &library) {
 	if(cur_scope.library != library) {
 		cur_scope.library = library;
@@ -466,30 +640,130 @@ void LibraryView::LibraryModel::navigateBack() {
 
 
 void LibraryView::LibraryModel::onItemActivated(const QModelIndex &index) {
+	if(isTopLevelScope()) {
+		QDesktopServices::openUrl(QUrl(QString("file://") +
+			library->at(list.at(index.row()).toLocal8Bit()).getPath()));
+		return;
+	}
+
+	cur_scope = childScope(index.row());
+	refreshList();
+}
+
+
+/**
+ * Updates item showing comic with md5_hash, either it's own item, or the item of the group it's in.
+ */
+void LibraryView::LibraryModel::onThumbReady(const QByteArray &md5_hash) {
+	if(!library->contains(md5_hash)) return;
+	const ComicInfo &info = library->at(md5_hash).info;
+
+	int row = -1;
 	switch(cur_scope.category) {
 		case PUBLISHER_SCOPE:
-			cur_scope.publisher	=	list.at(index.row());
-			cur_scope.category	=	SERIES_SCOPE;
+			row = rowOf(info.getPublisher());
 			break;
 
 		case SERIES_SCOPE:
-			cur_scope.series	=	list.at(index.row());
-			cur_scope.category	=	VOLUME_SCOPE;
+			row = rowOf(info.getSeries());
 			break;
 
 		case VOLUME_SCOPE:
-			cur_scope.volume	=	list.at(index.row());
-			cur_scope.category	=	TITLE_SCOPE;
+			if(info.getSeries() == cur_scope.series) row = rowOf(info.getVolume());
 			break;
 
 		case TITLE_SCOPE:
 		case LIST_SCOPE:
-			QDesktopServices::openUrl(QUrl(QString("file://") +
-				library->at(list.at(index.row()).toLocal8Bit()).getPath()));
+			row = rowOf(QString(md5_hash));
 			break;
 	}
 
-	refreshList();
+	if(row != -1) emit dataChanged(index(row, 0), index(row, 0), {Qt::DecorationRole});
+}
+
+
+/**
+ * Requests missing thumbnails of item at row with priority, for groups it's the covers that are
+ * layered in it's icon.
+ */
+void LibraryView::LibraryModel::requestThumbs(const int row,
+		const ThumbnailService::Priority priority) const {
+	QList<ComicFile> comic_list;
+
+	switch(cur_scope.category) {
+		case PUBLISHER_SCOPE:
+		case SERIES_SCOPE:
+		case VOLUME_SCOPE:
+			comic_list = getGroupCovers(row);
+			break;
+
+		case TITLE_SCOPE:
+		case LIST_SCOPE:
+			comic_list << library->at(list.at(row).toLocal8Bit());
+			break;
+	}
+
+	for(const ComicFile &comic : comic_list) {
+		if(!comic.isNull() && !comic.hasThumb()) {
+			thumbnail_service->request(comic, priority);
+		}
+	}
+}
+
+
+/**
+ * Replaces queued prefetches with items in rows first to last, see prefetchNext().
+ */
+void LibraryView::LibraryModel::prefetchRows(const int first, const int last) {
+	prefetch_queue.clear();
+
+	for(int row = first; row <= last && row < list.size(); row++) {
+		if(isTopLevelScope()) {
+			prefetch_queue.append(Prefetch{{list.at(row).toLocal8Bit()}, false});
+		} else {
+			prefetch_queue.append(Prefetch{group_covers.value(list.at(row)), true});
+		}
+	}
+}
+
+
+/**
+ * Replaces queued prefetches with the first count items of scope that activating item at row
+ * would navigate to, so it's covers are ready by the time it's opened.
+ */
+void LibraryView::LibraryModel::prefetchScope(const int row, const int count) {
+	prefetch_queue.clear();
+	if(isTopLevelScope() || row < 0 || row >= list.size()) return;
+
+	if(child_items.isEmpty()) buildChildItems();
+
+	const bool is_group = (childScope(row).category != TITLE_SCOPE);
+	const QMap<QString, QList<QByteArray>> items = child_items.value(list.at(row));
+	int i = 0;
+	for(auto iter = items.constBegin(); iter != items.constEnd() && i < count; ++iter, i++) {
+		prefetch_queue.append(Prefetch{iter.value(), is_group});
+	}
+}
+
+
+/**
+ * Loads thumbnails or group icons of up to count queued items into memory, requesting any that
+ * haven't been generated. Returns true if more are queued.
+ */
+bool LibraryView::LibraryModel::prefetchNext(const int count) {
+	for(int i = 0; i < count && !prefetch_queue.isEmpty(); i++) {
+		Prefetch prefetch = prefetch_queue.takeFirst();
+		QList<ComicFile> comic_list = getComics(prefetch.md5_hash_list);
+		if(comic_list.isEmpty()) continue;
+
+		if(prefetch.is_group) {
+			groupIcon(comic_list);
+		} else if(getThumbPixmap(comic_list.first()).isNull()) {
+			thumbnail_service->request(comic_list.first(), ThumbnailService::NORMAL_PRIORITY);
+		}
+	}
+
+	return !prefetch_queue.isEmpty();
 }
 
 
@@ -501,6 +775,8 @@ void LibraryView::LibraryModel::onItemActivated(const QModelIndex &index) {
 LibraryView::LibraryModel::LibraryModel(QObject *parent) : QAbstractListModel(parent) {
 	parent		=	(LibraryView*)parent;
 	mime_data	=	new QMimeData();
+	group_icons.setMaxCost(ICON_CACHE_SIZE);
+	thumb_cache.setMaxCost(THUMB_CACHE_SIZE);
 }
 
 
@@ -510,11 +786,259 @@ LibraryView::LibraryModel::~LibraryModel() {
 
 
 /**
- * Layers covers of first 3 comics in comic_list, and returns a QIcon.
+ * Returns scope that activating group at row navigates to.
+ */
+LibraryView::LibraryModel::ScopeState LibraryView::LibraryModel::childScope(const int row) const {
+	ScopeState scope = cur_scope;
+
+	switch(scope.category) {
+		case PUBLISHER_SCOPE:
+			scope.publisher	=	list.at(row);
+			scope.category	=	SERIES_SCOPE;
+			break;
+
+		case SERIES_SCOPE:
+			scope.series	=	list.at(row);
+			scope.category	=	VOLUME_SCOPE;
+			break;
+
+		case VOLUME_SCOPE:
+			scope.volume	=	list.at(row);
+			scope.category	=	TITLE_SCOPE;
+			break;
+
+		case TITLE_SCOPE:
+		case LIST_SCOPE:
+			break;
+	}
+
+	return scope;
+}
+
+
+/**
+ * Returns rows for scope, sorted, with the covers of each group and the signature of each row.
+ * Each comic is only looked at once, and groups are collected in a hash, rather than checking the
+ * list for each comic.
+ */
+LibraryView::LibraryModel::Rows LibraryView::LibraryModel::buildRows(const ScopeState &scope)
+		const {
+	Rows rows;
+
+	// Covers of a group are the first 3 comics in it
+	auto add_group_cover = [&rows](const QString &group, const ComicFile &comic) {
+		QList<QByteArray> &md5_hash_list = rows.group_covers[group];
+		if(md5_hash_list.size() < 3) md5_hash_list.append(comic.getMd5Hash());
+	};
+
+	for(const ComicFile &comic : *library) {
+		if(!inScope(scope, comic)) continue;
+
+		if(scope.category == TITLE_SCOPE) {
+			// Everything data() shows for comic
+			QStringList shown({comic.info.getSeries(), comic.info.getVolume(),
+					comic.info.getNumber(), comic.info.getTitle()});
+			rows.signatures.insert(comic.getMd5Hash(),
+					shown.join('\n').toUtf8() + '\n' + comic.getCoverHash());
+		} else add_group_cover(itemOf(scope.category, comic), comic);
+	}
+
+	// Group names never change, only their covers do
+	for(auto iter = rows.group_covers.constBegin(); iter != rows.group_covers.constEnd(); ++iter) {
+		QByteArray signature;
+		for(const QByteArray &md5_hash : iter.value()) {
+			signature += md5_hash + library->at(md5_hash).getCoverHash();
+		}
+
+		rows.signatures.insert(iter.key(), signature);
+	}
+
+	rows.list = rows.signatures.keys();
+	qSort(rows.list);
+
+	return rows;
+}
+
+
+/**
+ * Builds child_items in one pass over library, for every row at once. Items are kept sorted and
+ * with the same covers as buildRows() would give the row's child scope.
  */
-QIcon LibraryView::LibraryModel::layeredIcon(const QList<ComicFile> &comic_list) const {
+void LibraryView::LibraryModel::buildChildItems() {
+	if(isTopLevelScope() || list.isEmpty()) return;
+
+	const ScopeCategory child_category = childScope(0).category;
+	for(const ComicFile &comic : *library) {
+		if(!inScope(cur_scope, comic)) continue;
+
+		QList<QByteArray> &md5_hash_list =
+				child_items[itemOf(cur_scope.category, comic)][itemOf(child_category, comic)];
+		if(md5_hash_list.size() < 3) md5_hash_list.append(comic.getMd5Hash());
+	}
+}
+
+
+/**
+ * Returns true if comic is shown in scope, either as it's own item or in a group.
+ */
+bool LibraryView::LibraryModel::inScope(const ScopeState &scope, const ComicFile &comic) {
+	// Skip comics that are not part of selected library
+	if(scope.library != "All" &&
+		!(comic.info.getManga() == "Yes" && scope.library == "Manga") &&
+		!(comic.info.getManga() == "No" && scope.library == "Comics") &&
+		scope.user_list.isEmpty()) return false;
+
+	switch(scope.category) {
+		case PUBLISHER_SCOPE:
+			return true;
+
+		case SERIES_SCOPE:
+			return scope.publisher == comic.info.getPublisher() || scope.publisher == "All";
+
+		case VOLUME_SCOPE:
+			return (scope.publisher == comic.info.getPublisher() || scope.publisher == "All") &&
+					scope.series == comic.info.getSeries();
+
+		case TITLE_SCOPE:
+			return (scope.publisher == comic.info.getPublisher() || scope.publisher == "All") &&
+					scope.series == comic.info.getSeries() &&
+					scope.volume == comic.info.getVolume();
+
+		case LIST_SCOPE:
+			//TODO: PARSE USER-MADE LIST TO ADD COMICS
+			return false;
+	}
+
+	return false;
+}
+
+
+/**
+ * Returns item comic is shown in at category, the name of it's group, or it's own md5 hash.
+ */
+QString LibraryView::LibraryModel::itemOf(const ScopeCategory category, const ComicFile &comic) {
+	switch(category) {
+		case PUBLISHER_SCOPE:
+			return comic.info.getPublisher();
+
+		case SERIES_SCOPE:
+			return comic.info.getSeries();
+
+		case VOLUME_SCOPE:
+			return comic.info.getVolume();
+
+		case TITLE_SCOPE:
+		case LIST_SCOPE:
+			break;
+	}
+
+	return QString(comic.getMd5Hash());
+}
+
+
+/**
+ * Returns row of item, or -1 if it isn't in list. List is sorted, so it's a binary search.
+ */
+int LibraryView::LibraryModel::rowOf(const QString &item) const {
+	auto iter = std::lower_bound(list.constBegin(), list.constEnd(), item);
+	return (iter != list.constEnd() && *iter == item) ? int(iter - list.constBegin()) : -1;
+}
+
+
+/**
+ * Returns comics whose covers are layered in icon of group (publisher, series, or volume) at row.
+ */
+QList<ComicFile> LibraryView::LibraryModel::getGroupCovers(const int row) const {
+	return getComics(group_covers.value(list.at(row)));
+}
+
+
+/**
+ * Returns comics with md5 hashes in md5_hash_list, skipping any no longer in library.
+ */
+QList<ComicFile> LibraryView::LibraryModel::getComics(const QList<QByteArray> &md5_hash_list)
+		const {
+	QList<ComicFile> comic_list;
+	for(const QByteArray &md5_hash : md5_hash_list) {
+		const ComicFile &comic = library->at(md5_hash);
+		if(!comic.isNull()) comic_list.append(comic);
+	}
+
+	return comic_list;
+}
+
+
+/**
+ * Returns icon of group with covers of comic_list. Layering covers is only done once for each set
+ * of covers, the result is kept in group_icons, and in ThumbnailService once evicted from memory,
+ * both keyed by the cover hashes and icon size, so they never go stale, a changed cover just makes
+ * a new key. Icons with covers still being generated aren't kept, since they have placeholders in
+ * them.
+ */
+QIcon LibraryView::LibraryModel::groupIcon(const QList<ComicFile> &comic_list) const {
 	if(comic_list.isEmpty()) return QIcon();
 
+	QByteArray key = QByteArray::number(library_view->icon_size);
+	for(const ComicFile &comic : comic_list) {
+		if(comic.getCoverHash().isEmpty() || !comic.hasThumb()) {
+			return QIcon(QPixmap::fromImage(layerCovers(comic_list)));
+		}
+
+		key += ":" + comic.getCoverHash();
+	}
+
+	QByteArray icon_hash = QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex();
+	QPixmap *pixmap = group_icons.object(icon_hash);
+	if(pixmap == nullptr) {
+		QImage image = thumbnail_service->getIcon(icon_hash, library_view->icon_size);
+		if(image.isNull()) {
+			image = layerCovers(comic_list);
+
+			try {
+				thumbnail_service->putIcon(icon_hash, library_view->icon_size, image);
+			} catch(const eComics::Exception &e) { e.printMsg(); }
+		}
+
+		pixmap = new QPixmap(QPixmap::fromImage(image));
+		group_icons.insert(icon_hash, pixmap, pixmap->width() * pixmap->height() * 4 / 1024);
+	}
+
+	return QIcon(*pixmap);
+}
+
+
+/**
+ * Returns thumbnail of comic at icon size, or a null QPixmap if it hasn't been generated yet.
+ * Thumbnails are kept in thumb_cache once converted, up to THUMB_CACHE_SIZE, least recently used
+ * are dropped first.
+ */
+QPixmap LibraryView::LibraryModel::getThumbPixmap(const ComicFile &comic) const {
+	QByteArray cover_hash = comic.getCoverHash();
+	QByteArray key = cover_hash + ":" + QByteArray::number(library_view->icon_size);
+
+	QPixmap *pixmap = (cover_hash.isEmpty()) ? nullptr : thumb_cache.object(key);
+	if(pixmap != nullptr) return *pixmap;
+
+	QImage thumb = comic.getThumb(library_view->icon_size);
+	if(thumb.isNull()) return QPixmap();
+
+	// Not kept until cover hash is recorded, the key would be missing it
+	QPixmap result = QPixmap::fromImage(thumb);
+	if(!cover_hash.isEmpty()) {
+		thumb_cache.insert(key, new QPixmap(result), result.width() * result.height() * 4 / 1024);
+	}
+
+	return result;
+}
+
+
+/**
+ * Layers covers of first 3 comics in comic_list into one image. Covers whose thumbnail isn't ready
+ * yet are requested, and drawn as placeholders.
+ */
+QImage LibraryView::LibraryModel::layerCovers(const QList<ComicFile> &comic_list) const {
+	if(comic_list.isEmpty()) return QImage();
+
 	int offset = 10, square_size;
 	int total_width = 0, total_height = 0;
 
@@ -529,9 +1053,13 @@ QIcon LibraryView::LibraryModel::layeredIcon(const QList<ComicFile> &comic_list)
 
 	// Next get images and exact total size
 	for(int i = 0; i < 3 && i < comic_list.size(); i++) {
-		image[i] = (
-			QImage(comic_list[i].getThumbPath())
-		).scaled(square_size, square_size, Qt::KeepAspectRatio);
+		image[i] = comic_list[i].getThumb(square_size);
+		if(image[i].isNull()) {
+			thumbnail_service->request(comic_list[i], ThumbnailService::NORMAL_PRIORITY);
+			image[i] = library_view->placeholder.toImage();
+		}
+
+		image[i] = ImageScaler::scaled(image[i], square_size, square_size);
 
 		if(i == 0) {
 			total_width = image[i].width();
@@ -557,5 +1085,5 @@ QIcon LibraryView::LibraryModel::layeredIcon(const QList<ComicFile> &comic_list)
 	}
 
 	painter.end();
-	return QIcon(QPixmap::fromImage(result));
+	return result;
 }
\ No newline at end of file
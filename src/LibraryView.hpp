@@ -22,10 +22,18 @@
 
 
 #include <QAbstractListModel>
+#include <QCache>
+#include <QHash>
 #include <QListView>
+#include <QMap>
+#include <QPair>
+#include <QPersistentModelIndex>
+#include <QPixmap>
 #include <QPointer>
+#include <QTimer>
 
 #include "ReferenceList.hpp"
+#include "ThumbnailService.hpp"
 
 
 class ComicFile;
@@ -40,9 +48,13 @@ class LibraryView : public QListView {
 	Q_OBJECT
 
 	public:
+		// Icon size is ThumbnailService::MIN_ICON_SIZE doubled once for each step of zoom
+		static const int MAX_ZOOM = 2;
+
 		static void init(QWidget *parent = 0);
 		static void destroy();
 		ReferenceList<ComicFile> getSelectedComics();
+		int getZoom() const;
 		void resetScope();
 
 	public slots:
@@ -50,6 +62,9 @@ class LibraryView : public QListView {
 		void onListChanged(QString list);
 		void onItemActivated(const QModelIndex &index);
 		void onNavigateBack();
+		void onThumbReady(const QByteArray &md5_hash);
+		void requestVisibleThumbs();
+		void setZoom(int zoom);
 
 	private:
 		// This model uses the library singleton as it's data list
@@ -63,10 +78,16 @@ class LibraryView : public QListView {
 				QMimeData * mimeData(const QModelIndexList &index_list) const;
 				int rowCount(const QModelIndex &parent = QModelIndex()) const;
 				void refreshList();
+				void updateList();
 				void setSelectedLibrary(const QString &library);
 				void setSelectedUserList(const QString &list);
 				void navigateBack();
 				void onItemActivated(const QModelIndex &index);
+				void onThumbReady(const QByteArray &md5_hash);
+				void requestThumbs(const int row, const ThumbnailService::Priority priority) const;
+				void prefetchRows(const int first, const int last);
+				void prefetchScope(const int row, const int count);
+				bool prefetchNext(const int count);
 				friend ReferenceList<ComicFile> LibraryView::getSelectedComics();
 				friend void LibraryView::resetScope();
 
@@ -86,10 +107,45 @@ class LibraryView : public QListView {
 					LIST_SCOPE // Viewing list of comics from cur_list
 				};
 
+				static const int ICON_CACHE_SIZE = 32 * 1024; // Kilobytes of group icons in memory
+				static const int THUMB_CACHE_SIZE = 64 * 1024; // Kilobytes of thumbnails in memory
+
+				// Item whose thumbnail or icon is to be loaded ahead of being shown
+				struct Prefetch {
+					QList<QByteArray> md5_hash_list; // Comic, or covers of group
+					bool is_group;
+				};
+
 				LibraryView *parent;
 				QStringList list;
 				mutable QPointer<QMimeData> mime_data;
 
+				// Rows of model and what's shown in them, built in one pass over library
+				struct Rows {
+					QStringList list;
+					QHash<QString, QList<QByteArray>> group_covers;
+					QHash<QString, QByteArray> signatures;
+				};
+
+				// Md5 hashes of first 3 comics in each group, the covers layered in it's icon
+				QHash<QString, QList<QByteArray>> group_covers;
+
+				// Everything shown in each row, so updateList() can tell which rows changed
+				QHash<QString, QByteArray> signatures;
+
+				// Layered group icons by hash of their covers, once evicted they're read back from
+				// ThumbnailService
+				mutable QCache<QByteArray, QPixmap> group_icons;
+
+				// Thumbnails of comics by cover hash and size, so repaints don't convert them again
+				mutable QCache<QByteArray, QPixmap> thumb_cache;
+
+				QList<Prefetch> prefetch_queue;
+
+				// Items of each row's child scope, with their covers, built on the first
+				// prefetchScope() after list changes, so hovering doesn't walk library every time
+				QHash<QString, QMap<QString, QList<QByteArray>>> child_items;
+
 				// Variables to keep track of scope
 				struct ScopeState {
 					ScopeCategory category;
@@ -115,19 +171,46 @@ class LibraryView : public QListView {
 
 				LibraryModel(QObject *parent);
 				~LibraryModel();
-				QIcon layeredIcon(const QList<ComicFile> &comic_list) const;
+				ScopeState childScope(const int row) const;
+				Rows buildRows(const ScopeState &scope) const;
+				void buildChildItems();
+				static bool inScope(const ScopeState &scope, const ComicFile &comic);
+				static QString itemOf(const ScopeCategory category, const ComicFile &comic);
+				int rowOf(const QString &item) const;
+				QList<ComicFile> getGroupCovers(const int row) const;
+				QList<ComicFile> getComics(const QList<QByteArray> &md5_hash_list) const;
+				QIcon groupIcon(const QList<ComicFile> &comic_list) const;
+				QPixmap getThumbPixmap(const ComicFile &comic) const;
+				QImage layerCovers(const QList<ComicFile> &comic_list) const;
 		};
 
+		static const int SPACING = 15;
+		static const int NUM_OF_TEXT_LINES = 3; // Series, volume and number, and title
+		static const int BATCH_SIZE = 500; // Items laid out at a time, between events
+		static const int PREFETCH_BATCH = 4; // Items prefetched at a time, between events
+		static const int HOVER_DELAY = 250; // Milliseconds hovered before prefetching next scope
+
 		// Private vairables
 		static LibraryModel *model;
-		int icon_size;
+		int icon_size; // Always one of the sizes ThumbnailService stores, so icons aren't rescaled
+		QPixmap placeholder; // Shown in place of thumbnails that are still being generated
+		int last_scroll_value = 0; // To tell which way view is being scrolled
+		QTimer prefetch_timer;
+		QTimer hover_timer;
+		QPersistentModelIndex hovered_index;
 
 		LibraryView(QWidget *parent = 0);
 		~LibraryView();
+		QPair<int, int> rowsInRect(const QRect &rect) const;
+		int getItemsPerScreen() const;
 
 		private slots:
 			void onSelectionChanged(const QItemSelection &selected,
 				const QItemSelection &deselected);
+			void onCurrentChanged(const QModelIndex &current, const QModelIndex &previous);
+			void onItemHovered(const QModelIndex &index);
+			void prefetchHoveredScope();
+			void prefetchNext();
 };
 
 extern LibraryView *library_view;
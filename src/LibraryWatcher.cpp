@@ -0,0 +1,249 @@
+#include "LibraryWatcher.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <QDebug>
+#include <QDirIterator>
+
+#include "Config.hpp"
+#include "FileStat.hpp"
+#include "Library.hpp"
+
+
+LibraryWatcher *library_watcher = nullptr;
+
+
+// Events that can add, change, move, or remove a comic
+static const quint32 WATCH_MASK	=	IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+									IN_DELETE | IN_ONLYDIR;
+
+// Milliseconds without new events before they're flushed, and longest an event waits regardless
+static const int DEBOUNCE_DELAY	=	2000;
+static const int MAX_LATENCY	=	10000;
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *								LIBRARYWATCHER PUBLIC METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+void LibraryWatcher::init() {
+	if(library_watcher == nullptr) {
+		library_watcher = new LibraryWatcher;
+	}
+}
+
+
+void LibraryWatcher::destroy() {
+	if(library_watcher != nullptr) {
+		delete library_watcher;
+		library_watcher = nullptr;
+	}
+}
+
+
+/**
+ * Drops all watches and pending events, then watches Comic and/or Manga directories as they are
+ * currently set in Config. Should be called whenever those directories are changed.
+ */
+void LibraryWatcher::reset() {
+	if(inotify_fd == -1) return;
+
+	for(int wd : watch_paths.keys()) inotify_rm_watch(inotify_fd, wd);
+	watch_paths.clear();
+	pending_moves.clear();
+	changed_paths.clear();
+	removed_paths.clear();
+	new_dirs.clear();
+	renamed_paths.clear();
+	debounce_timer.stop();
+	pending_timer.invalidate();
+	overflowed = false;
+
+	if(config->isComicEnabled()) watchTree(config->getComicPath());
+	if(config->isMangaEnabled()) watchTree(config->getMangaPath());
+
+	qDebug() << "Watching" << watch_paths.size() << "directories for changes";
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *								LIBRARYWATCHER PRIVATE METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+LibraryWatcher::LibraryWatcher() : notifier(nullptr) {
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(inotify_fd == -1) {
+		qDebug() << "LibraryWatcher error: inotify_init1() failed," << strerror(errno) <<
+			"changes will only be found by scanning the library";
+		return;
+	}
+
+	notifier = new QSocketNotifier(inotify_fd, QSocketNotifier::Read, this);
+	connect(notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+
+	// Download tools write files in many small steps, so wait for events to settle before flushing
+	debounce_timer.setSingleShot(true);
+	connect(&debounce_timer, SIGNAL(timeout()), this, SLOT(flushEvents()));
+
+	reset();
+}
+
+
+LibraryWatcher::~LibraryWatcher() {
+	delete notifier;
+	if(inotify_fd != -1) close(inotify_fd);
+}
+
+
+/**
+ * Adds a watch for root_path and every directory under it.
+ */
+void LibraryWatcher::watchTree(const QString &root_path) {
+	QStringList dir_list( {root_path} );
+	QDirIterator iter(root_path, QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden,
+		QDirIterator::Subdirectories);
+	while(iter.hasNext()) dir_list << iter.next();
+
+	for(const QString &dir_path : dir_list) {
+		int wd = inotify_add_watch(inotify_fd, QFile::encodeName(dir_path).constData(), WATCH_MASK);
+		if(wd == -1) {
+			// ENOSPC means fs.inotify.max_user_watches has been reached
+			qDebug() << "LibraryWatcher error: failed to watch" << dir_path << strerror(errno);
+			continue;
+		}
+
+		watch_paths.insert(wd, dir_path);
+	}
+}
+
+
+/**
+ * Removes watches for root_path and every directory under it.
+ */
+void LibraryWatcher::unwatchTree(const QString &root_path) {
+	for(int wd : watch_paths.keys()) {
+		const QString &dir_path = watch_paths[wd];
+		if(dir_path == root_path || dir_path.startsWith(root_path + "/")) {
+			inotify_rm_watch(inotify_fd, wd);
+			watch_paths.remove(wd);
+		}
+	}
+}
+
+
+/**
+ * Reads all available inotify events and sorts them into the pending path sets, then (re)starts
+ * the debounce timer, never past MAX_LATENCY from the first pending event.
+ */
+void LibraryWatcher::readEvents() {
+	alignas(struct inotify_event) char buf[4096];
+	ssize_t len;
+
+	while((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+		for(char *ptr = buf; ptr < buf + len;) {
+			const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			// Kernel dropped events, only a full scan can catch up
+			if(event->mask & IN_Q_OVERFLOW) {
+				overflowed = true;
+				continue;
+			}
+
+			// Watch was removed (directory deleted or moved out of tree)
+			if(event->mask & IN_IGNORED) {
+				watch_paths.remove(event->wd);
+				continue;
+			}
+
+			if(event->len == 0 || !watch_paths.contains(event->wd)) continue;
+
+			QString path	=	watch_paths[event->wd] + "/" + QFile::decodeName(event->name);
+			bool is_dir		=	event->mask & IN_ISDIR;
+
+			if(event->mask & IN_MOVED_FROM) {
+				pending_moves.insert(event->cookie, path);
+			} else if(event->mask & IN_MOVED_TO) {
+				if(pending_moves.contains(event->cookie)) {
+					renamed_paths << qMakePair(pending_moves.take(event->cookie), path);
+				}
+
+				// A file renamed into place (e.g. "comic.cbz.part" -> "comic.cbz") may be new
+				if(is_dir) new_dirs << path;
+				else changed_paths << path;
+			} else if(event->mask & IN_CREATE) {
+				if(is_dir) new_dirs << path;
+				else changed_paths << path;
+			} else if(event->mask & IN_CLOSE_WRITE) {
+				changed_paths << path;
+			} else if(event->mask & IN_DELETE) {
+				removed_paths << path;
+				changed_paths.remove(path);
+			}
+		}
+	}
+
+	// A long copy never settles, so events it keeps sending mustn't hold back the ones before it
+	if(!pending_timer.isValid()) pending_timer.start();
+	const qint64 remaining = MAX_LATENCY - pending_timer.elapsed();
+	debounce_timer.start(int(qBound(qint64(0), remaining, qint64(DEBOUNCE_DELAY))));
+}
+
+
+/**
+ * Called once events have settled, or the oldest has waited MAX_LATENCY, passes renamed, removed,
+ * and changed paths to Library.
+ */
+void LibraryWatcher::flushEvents() {
+	pending_timer.invalidate();
+
+	if(overflowed) {
+		qDebug() << "LibraryWatcher: event queue overflowed, scanning library";
+		overflowed = false;
+		library->scanDirectories();
+		reset();
+		return;
+	}
+
+	// Anything moved out and never moved back in to a watched directory is gone
+	for(const QString &path : pending_moves) {
+		removed_paths << path;
+		unwatchTree(path);
+	}
+	pending_moves.clear();
+
+	// Renamed directories keep their watches, only the path they are known by changes
+	for(const QPair<QString, QString> &pair : renamed_paths) {
+		for(auto iter = watch_paths.begin(); iter != watch_paths.end(); ++iter) {
+			if(iter.value() == pair.first || iter.value().startsWith(pair.first + "/")) {
+				iter.value() = pair.second + iter.value().mid(pair.first.size());
+			}
+		}
+	}
+
+	// New directories need watches, and any files already in them need to be added
+	for(const QString &dir_path : new_dirs) {
+		if(!FileStat::fromPath(dir_path).isDir()) continue;
+
+		bool is_renamed = false;
+		for(const QPair<QString, QString> &pair : renamed_paths) {
+			if(pair.second == dir_path) is_renamed = true;
+		}
+
+		if(!is_renamed) watchTree(dir_path);
+
+		QDirIterator iter(dir_path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+		while(iter.hasNext()) changed_paths << iter.next();
+	}
+
+	library->updatePaths(renamed_paths, removed_paths.toList(), changed_paths.toList());
+
+	changed_paths.clear();
+	removed_paths.clear();
+	new_dirs.clear();
+	renamed_paths.clear();
+}
\ No newline at end of file
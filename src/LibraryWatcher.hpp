@@ -0,0 +1,78 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * LibraryWatcher.hpp                                                          *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef LIBRARYWATCHER_HPP
+#define LIBRARYWATCHER_HPP
+
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTimer>
+
+
+/**
+ * class LibraryWatcher
+ *
+ * Singleton that watches the Comic and/or Manga directories (and all of their subdirectories) with
+ * inotify, so comics that are added, changed, moved, or deleted outside of eComics show up in the
+ * library without a full rescan. Events are collected until no new events have arrived for a short
+ * while, or until the oldest has waited too long, then only the affected paths are passed to
+ * Library. A rename within the watched trees is passed on as a path update rather than as a delete
+ * and a re-import.
+ */
+class LibraryWatcher : public QObject {
+	Q_OBJECT
+
+	public:
+		static void init();
+		static void destroy();
+		void reset();
+
+	private:
+		int inotify_fd;
+		QSocketNotifier *notifier;
+		QTimer debounce_timer;
+		QElapsedTimer pending_timer; // Started by first event since last flush
+		QHash<int, QString> watch_paths; // Watch descriptor -> directory path
+		QHash<quint32, QString> pending_moves; // Cookie -> path moved from, until matched
+		QSet<QString> changed_paths; // Files that were created or written to
+		QSet<QString> removed_paths; // Files or directories that were deleted or moved out
+		QSet<QString> new_dirs; // Directories that were created or moved in
+		QList<QPair<QString, QString>> renamed_paths; // Renames within watched trees (from, to)
+		bool overflowed = false; // Kernel event queue overflowed, events were lost
+
+		LibraryWatcher();
+		~LibraryWatcher();
+		void watchTree(const QString &root_path);
+		void unwatchTree(const QString &root_path);
+
+	private slots:
+		void readEvents();
+		void flushEvents();
+};
+
+
+extern LibraryWatcher *library_watcher;
+
+
+#endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <QApplication>
 #include <QSettings>
+#include <QSlider>
 #include <QSplitter>
 #include <QStatusBar>
 
@@ -10,9 +11,11 @@
 #include "Config.hpp"
 #include "FirstRunDialog.hpp"
 #include "Library.hpp"
+#include "LibraryView.hpp"
 #include "MainSidePane.hpp"
 #include "MainView.hpp"
 #include "MenuBar.hpp"
+#include "MetadataWriter.hpp"
 #include "PreferencesDialog.hpp"
 
 
@@ -112,6 +115,16 @@ MainWindow::MainWindow() {
 	main_splitter->setSizes( {150, 650} );
 	main_splitter->setCollapsible(1, false);
 
+	// Zoom slider steps through the thumbnail sizes library view can show without rescaling
+	zoom_slider = new QSlider(Qt::Horizontal, status_bar);
+	zoom_slider->setRange(0, LibraryView::MAX_ZOOM);
+	zoom_slider->setPageStep(1);
+	zoom_slider->setTickPosition(QSlider::TicksBelow);
+	zoom_slider->setMaximumWidth(100);
+	zoom_slider->setToolTip(tr("Zoom"));
+	zoom_slider->setValue(library_view->getZoom());
+	status_bar->addPermanentWidget(zoom_slider);
+
 	resize(800, 600);
 
 	// Initialize comic info dialog
@@ -126,6 +139,12 @@ MainWindow::MainWindow() {
 	connect(eComics::actions->quit(), SIGNAL(triggered()), qApp, SLOT(quit()));
 	connect(eComics::actions->fullScreen(), SIGNAL(toggled(bool)), this,
 			SLOT(toggleFullscreen(bool)));
+	connect(zoom_slider, SIGNAL(valueChanged(int)), library_view, SLOT(setZoom(int)));
+
+	// Show status of queued metadata writes
+	connect(metadata_writer, SIGNAL(pendingChanged(int)), this, SLOT(onPendingWritesChanged(int)));
+	connect(metadata_writer, SIGNAL(failed(const QString &, const QString &)), this,
+			SLOT(onWriteFailed(const QString &, const QString &)));
 }
 
 
@@ -150,6 +169,7 @@ void MainWindow::closeEvent(QCloseEvent *event) {
 	settings.setValue("MainWindow.State", saveState());
 	settings.setValue("MainSplitter.State", main_splitter->saveState());
 	settings.setValue("StatusBar.Visible", status_bar->isVisible());
+	settings.setValue("LibraryView.Zoom", zoom_slider->value());
 	QMainWindow::closeEvent(event);
 }
 
@@ -181,6 +201,11 @@ void MainWindow::restoreSettings() {
 		eComics::actions->statusBar()->setChecked(true);
 		status_bar->setVisible(true);
 	}
+
+	// Restore zoom, library view follows slider
+	if(settings.contains("LibraryView.Zoom")) {
+		zoom_slider->setValue(settings.value("LibraryView.Zoom").toInt());
+	}
 }
 
 
@@ -192,4 +217,18 @@ void MainWindow::toggleFullscreen(bool full_screen) {
 
 void MainWindow::toggleStatusBar(bool visible) {
 	status_bar->setVisible(visible);
+}
+
+
+void MainWindow::onPendingWritesChanged(int num_of_pending) {
+	if(num_of_pending > 0) {
+		status_bar->showMessage(tr("Saving metadata to %n comic(s)...", "", num_of_pending));
+	} else {
+		status_bar->showMessage(tr("Metadata saved"), 3000);
+	}
+}
+
+
+void MainWindow::onWriteFailed(const QString &path, const QString &msg) {
+	status_bar->showMessage(tr("Failed to save metadata to %1: %2").arg(path, msg));
 }
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include <QMainWindow>
 
 
+class QSlider;
 class QStatusBar;
 class QSplitter;
 
@@ -69,6 +70,7 @@ class MainWindow : public QMainWindow {
 		static bool exiting;
 		QStatusBar *status_bar		=	nullptr;
 		QSplitter *main_splitter	=	nullptr; // Sidebar on left, mainview on right
+		QSlider *zoom_slider		=	nullptr; // Zoom of library view, in status bar
 
 		MainWindow();
 		~MainWindow();
@@ -76,6 +78,8 @@ class MainWindow : public QMainWindow {
 		void restoreSettings();
 
 	private slots:
+		void onPendingWritesChanged(int num_of_pending);
+		void onWriteFailed(const QString &path, const QString &msg);
 		void toggleFullscreen(bool full_screen);
 		void toggleStatusBar(bool visible);
 };
@@ -1,51 +1,38 @@
 #include "MetadataTag.hpp"
 
+#include "ComicInfo.hpp"
+
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  *									METADATATAG PUBLIC METHODS 									 *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 
-MetadataTag::MetadataTag(const MetadataTag &tag) : QObject() {
-	*this = tag;
-}
-
-
 /**
- * Initializes MetadataTag with name, value remains empty and null.
+ * Initializes MetadataTag referring to tag at index in info, if index is out of bounds then
+ * MetadataTag is null.
  */
-MetadataTag::MetadataTag(const QString &_name, QObject *parent) : QObject(parent), name(_name) {}
-
-
-/**
- * Initializes MetadataTag with name and value.
- */
-MetadataTag::MetadataTag(const QString &_name, const QString &_value, QObject *parent)
-		: QObject(parent), name(_name), value(_value) {}
+MetadataTag::MetadataTag(ComicInfo *_info, const int _index) {
+	if(_index >= 0 && _index < ComicInfo::NUM_OF_TAGS) {
+		info	=	_info;
+		index	=	_index;
+	}
+}
 
 
 /**
  * MetadataTag getter methods.
  */
-QString MetadataTag::getName() const { return name; }
-QString MetadataTag::getValue() const { return value; }
+QString MetadataTag::getName() const { return ComicInfo::getName(index); }
+QString MetadataTag::getValue() const { return isNull() ? QString() : info->getValue(index); }
 
 
-void MetadataTag::setValue(const QString &_value) {
-	QString old_value(value);
-	value = _value;
-	emit changed(*this, old_value);
+void MetadataTag::setValue(const QString &value) {
+	if(!isNull()) info->setValue(index, value);
 }
 
+
 /**
- * If name is null, then tag is null.
+ * If MetadataTag doesn't refer to a tag, then it is null.
  */
-bool MetadataTag::isNull() const { return name.isNull(); }
-
-
-MetadataTag & MetadataTag::operator=(const MetadataTag &tag) {
-	name	=	tag.name;
-	value	=	tag.value;
-
-	return *this;
-}
\ No newline at end of file
+bool MetadataTag::isNull() const { return info == nullptr; }
\ No newline at end of file
@@ -22,38 +22,32 @@
 
 
 #include <QString>
-#include <QObject>
+
+
+class ComicInfo;
 
 
 /**
- * For this class to be used, it must be constructed with a tag name, once created it will be
- * impossible to edit tag name. If constructed without a tag name, then the MetadataTag will be
- * null. A tag name should never need to be changed, you can create a new MetadataTag with a new
- * name, and copy the value over if need be. Values in metadata tags are ALWAYS stored as QStrings,
- * even if it is a number, this is to simplify reading and writing XML. QString makes it VERY easy
- * to convert value to number, just use value.toLong(), value.toInt(), etc. If type should be bool,
- * it's just as easy to say if(value == "true").
+ * A MetadataTag refers to one of the tags of a ComicInfo by index, it doesn't hold a value itself,
+ * getValue() and setValue() go straight to the ComicInfo, so it's cheap to create and copy, and it
+ * must not outlive it's ComicInfo (except for getName(), which only needs the index). A
+ * default constructed MetadataTag is null. Values in metadata tags are ALWAYS QStrings, even if it
+ * is a number, this is to simplify reading and writing XML. QString makes it VERY easy to convert
+ * value to number, just use value.toLong(), value.toInt(), etc. If type should be bool, it's just
+ * as easy to say if(value == "true").
  */
-class MetadataTag : public QObject {
-	Q_OBJECT
-
+class MetadataTag {
 	public:
-		MetadataTag() {};
-		MetadataTag(const MetadataTag &tag);
-		MetadataTag(const QString &_name, QObject *parent = 0);
-		MetadataTag(const QString &_name, const QString &_value, QObject *parent = 0);
+		MetadataTag() {}
+		MetadataTag(ComicInfo *_info, const int _index);
 		QString getName() const;
 		QString getValue() const;
-		void setValue(const QString &_value);
+		void setValue(const QString &value);
 		bool isNull() const;
-		MetadataTag & operator=(const MetadataTag &tag);
-
-	signals:
-		void changed(const MetadataTag &tag, const QString old_value);
 
 	private:
-		QString name;
-		QString value;
+		ComicInfo *info	=	nullptr;
+		int index		=	-1;
 };
 
 
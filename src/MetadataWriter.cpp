@@ -0,0 +1,259 @@
+#include "MetadataWriter.hpp"
+
+#include <chrono>
+#include <QCryptographicHash>
+#include <QDebug>
+
+#include "Archive.hpp"
+#include "Exceptions.hpp"
+#include "Pdf.hpp"
+
+
+MetadataWriter *metadata_writer = nullptr;
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									METADATAWRITER PUBLIC METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+void MetadataWriter::init() {
+	if(metadata_writer == nullptr) metadata_writer = new MetadataWriter;
+}
+
+
+/**
+ * Writes everything still queued before returning, so no edits are lost on exit.
+ */
+void MetadataWriter::destroy() {
+	if(metadata_writer != nullptr) {
+		delete metadata_writer;
+		metadata_writer = nullptr;
+	}
+}
+
+
+/**
+ * Queues xml to be written to comic at path, replacing any xml that is still waiting to be written
+ * to the same path. Returns immediately, thread safe.
+ */
+void MetadataWriter::enqueue(const QString &path, const QByteArray &xml, const Format format) {
+	int num_of_pending;
+	QByteArray xml_hash = QCryptographicHash::hash(xml, QCryptographicHash::Md5).toHex();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending_writes.insert(path, Write{xml, xml_hash, format, 0, clock.elapsed() + DELAY});
+		queued_hashes.insert(path, xml_hash);
+		num_of_pending = pending_writes.size() + writing_paths.size();
+	}
+
+	condition.notify_one();
+	emit pendingChanged(num_of_pending);
+}
+
+
+/**
+ * Writes all queued xml right away, ignoring debounce and retry delays, blocks until finished.
+ */
+void MetadataWriter::flush() {
+	std::unique_lock<std::mutex> lock(mutex);
+	flushing = true;
+	condition.notify_one();
+	idle_condition.wait(lock, [this] {
+		return pending_writes.isEmpty() && writing_paths.isEmpty();
+	});
+	flushing = false;
+}
+
+
+/**
+ * Writes xml queued for path right away on the calling thread, after waiting for any write to path
+ * that's already under way, so the file can be renamed without the write landing on a path that's
+ * gone. Since it's written on the calling thread, written() or failed() is delivered before this
+ * returns when connected to an object on the same thread. Returns false if the write failed, in
+ * which case it may still be queued for a retry, see rename().
+ */
+bool MetadataWriter::flush(const QString &path) {
+	std::unique_lock<std::mutex> lock(mutex);
+	idle_condition.wait(lock, [this, &path] { return !writing_paths.contains(path); });
+	if(!pending_writes.contains(path)) return true;
+
+	return process(lock, path, pending_writes.take(path));
+}
+
+
+/**
+ * Moves xml queued for old_path to new_path, called once the comic at old_path has been renamed so
+ * a pending retry is written to the file where it now is.
+ */
+void MetadataWriter::rename(const QString &old_path, const QString &new_path) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if(pending_writes.contains(old_path) && !pending_writes.contains(new_path)) {
+		pending_writes.insert(new_path, pending_writes.take(old_path));
+	}
+
+	if(queued_hashes.contains(old_path)) {
+		queued_hashes.insert(new_path, queued_hashes.take(old_path));
+	}
+}
+
+
+/**
+ * Returns md5 hash of the xml last queued for path, which the file will have once it's written, or
+ * an empty QByteArray if nothing has been queued since the last write was recorded. Thread safe.
+ */
+QByteArray MetadataWriter::getQueuedHash(const QString &path) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return queued_hashes.value(path);
+}
+
+
+/**
+ * Called once the comic at path has recorded xml_hash from written(), or with an empty xml_hash
+ * after failed(). Hash of queued xml is dropped unless newer xml was queued since.
+ */
+void MetadataWriter::forgetQueuedHash(const QString &path, const QByteArray &xml_hash) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if(xml_hash.isEmpty() || queued_hashes.value(path) == xml_hash) queued_hashes.remove(path);
+}
+
+
+/**
+ * Returns number of comics waiting to be written, including the one being written.
+ */
+int MetadataWriter::getNumOfPending() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending_writes.size() + writing_paths.size();
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									METADATAWRITER PRIVATE METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+MetadataWriter::MetadataWriter() {
+	qRegisterMetaType<FileStat>("FileStat");
+	clock.start();
+	thread = std::thread(&MetadataWriter::run, this);
+}
+
+
+MetadataWriter::~MetadataWriter() {
+	flush();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_one();
+	thread.join();
+}
+
+
+/**
+ * Body of write thread, writes whichever queued comic is due first, one at a time.
+ */
+void MetadataWriter::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true) {
+		if(pending_writes.isEmpty()) {
+			if(stopping) break;
+			condition.wait(lock);
+			continue;
+		}
+
+		auto next = pending_writes.begin();
+		for(auto i = pending_writes.begin(); i != pending_writes.end(); ++i) {
+			if(i.value().due < next.value().due) next = i;
+		}
+
+		// Wait for debounce/retry delay, unless flushing, new writes may be queued in the meantime
+		qint64 wait = next.value().due - clock.elapsed();
+		if(!flushing && wait > 0) {
+			condition.wait_for(lock, std::chrono::milliseconds(wait));
+			continue;
+		}
+
+		QString path		=	next.key();
+		Write cur_write		=	next.value();
+		pending_writes.erase(next);
+		process(lock, path, cur_write);
+	}
+}
+
+
+/**
+ * Writes cur_write to path, then queues a retry or emits written()/failed(). lock must be held when
+ * called, it's released while writing and emitting, and held again on return. Returns true if
+ * write succeeded.
+ */
+bool MetadataWriter::process(std::unique_lock<std::mutex> &lock, const QString &path,
+		Write cur_write) {
+	writing_paths.insert(path);
+	lock.unlock();
+
+	FileStat file_stat;
+	QString error;
+
+	try {
+		write(path, cur_write);
+		file_stat = FileStat::fromPath(path);
+	} catch(const eComics::Exception &e) {
+		e.printMsg();
+		error = e.what();
+	}
+
+	lock.lock();
+	writing_paths.remove(path);
+
+	// Retry unless newer xml was queued in the meantime, which will be written anyway
+	bool gave_up = false;
+	if(!error.isEmpty() && !pending_writes.contains(path)) {
+		if(++cur_write.attempts < MAX_ATTEMPTS) {
+			cur_write.due = clock.elapsed() + RETRY_DELAY * cur_write.attempts;
+			pending_writes.insert(path, cur_write);
+			condition.notify_one();
+		} else {
+			gave_up = true;
+		}
+	}
+
+	int num_of_pending = pending_writes.size() + writing_paths.size();
+	idle_condition.notify_all();
+	lock.unlock();
+
+	if(error.isEmpty()) {
+		emit written(path, file_stat, cur_write.xml_hash);
+	} else if(gave_up) {
+		emit failed(path, error);
+	}
+	emit pendingChanged(num_of_pending);
+
+	lock.lock();
+	return error.isEmpty();
+}
+
+
+/**
+ * Possible Exceptions:
+ * - Any exception thrown by Archive or Pdf while opening or writing comic.
+ */
+void MetadataWriter::write(const QString &path, const Write &cur_write) const {
+	switch(cur_write.format) {
+		case ARCHIVE_FORMAT: {
+			Archive archive(path);
+			archive.setComicInfo(cur_write.xml);
+			break;
+		}
+
+		case PDF_FORMAT: {
+			Pdf pdf(path);
+			pdf.setComicInfo(cur_write.xml);
+			break;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * MetadataWriter.hpp                                                          *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef METADATAWRITER_HPP
+#define METADATAWRITER_HPP
+
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+
+#include "FileStat.hpp"
+
+
+/**
+ * class MetadataWriter
+ *
+ * Write-behind queue for embedding ComicInfo xml into archives and PDFs, so that editing metadata
+ * never waits on 7z/rar or PoDoFo. Writes are debounced and coalesced by path, if a comic is
+ * queued again before it's written then only the latest xml is written. All writes happen on one
+ * background thread, a failed write is retried a few times before giving up.
+ *
+ * Once a write lands, written() is emitted with the new stat of the file and the md5 hash of the
+ * xml written. Only ComicInfo.xml has changed, so the comic keeps it's md5 hash and the library
+ * just records the new stat and xml hash, the file is never read again to be rehashed.
+ */
+class MetadataWriter : public QObject {
+	Q_OBJECT
+
+	public:
+		enum Format {
+			ARCHIVE_FORMAT,
+			PDF_FORMAT
+		};
+
+		static void init();
+		static void destroy();
+		void enqueue(const QString &path, const QByteArray &xml, const Format format);
+		void flush();
+		bool flush(const QString &path);
+		void rename(const QString &old_path, const QString &new_path);
+		QByteArray getQueuedHash(const QString &path) const;
+		void forgetQueuedHash(const QString &path, const QByteArray &xml_hash);
+		int getNumOfPending() const;
+
+	signals:
+		void pendingChanged(int num_of_pending);
+		void written(const QString &path, const FileStat &file_stat, const QByteArray &xml_hash);
+		void failed(const QString &path, const QString &msg);
+
+	private:
+		struct Write {
+			QByteArray xml;
+			QByteArray xml_hash;
+			Format format;
+			int attempts;
+			qint64 due; // Time (from clock) when write should start
+		};
+
+		static const int DELAY			=	500; // Milliseconds to wait for more edits
+		static const int RETRY_DELAY	=	2000; // Multiplied by number of failed attempts
+		static const int MAX_ATTEMPTS	=	3;
+
+		QHash<QString, Write> pending_writes;
+		QSet<QString> writing_paths; // Paths being written right now, by thread or flush(path)
+		QHash<QString, QByteArray> queued_hashes; // Hash of xml last queued, until it's recorded
+		QElapsedTimer clock;
+		std::thread thread;
+		mutable std::mutex mutex;
+		std::condition_variable condition; // Wakes thread when writes are queued or flushed
+		std::condition_variable idle_condition; // Wakes flush() when a write finishes
+		bool flushing		=	false;
+		bool stopping		=	false;
+
+		MetadataWriter();
+		~MetadataWriter();
+		void run();
+		bool process(std::unique_lock<std::mutex> &lock, const QString &path, Write cur_write);
+		void write(const QString &path, const Write &cur_write) const;
+};
+
+extern MetadataWriter *metadata_writer;
+
+
+#endif
\ No newline at end of file
@@ -1,85 +1,214 @@
 #include "Page.hpp"
 
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+
+// Type names as they appear in XML, in order of Page::Type
+static const char *const type_name_list[] = {
+	"",
+	"FrontCover",
+	"InnerCover",
+	"Roundup",
+	"Story",
+	"Advertisment",
+	"Editorial",
+	"Letters",
+	"Preview",
+	"BackCover",
+	"Other",
+	"Deleted"
+};
+
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  *										PAGE PUBLIC METHODS 									 *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 
+Page::Page() : type(NO_TYPE), has_double_page(false), double_page(false) {}
+
+
+Page::Page(const Page &page) : image_size(page.image_size), image(page.image),
+		image_width(page.image_width), image_height(page.image_height), key(page.key),
+		type(page.type), has_double_page(page.has_double_page), double_page(page.double_page) {
+	StringPool::retain(key);
+}
+
+
 /**
- * Copy constructor.
+ * Initialize page with image number (index number of image in comic file)
  */
-Page::Page(const Page &page) {
-	*this = page;
+Page::Page(const int _image) : image(_image), type(NO_TYPE), has_double_page(false),
+		double_page(false) {}
+
+
+Page::~Page() {
+	StringPool::release(key);
 }
 
 
 /**
- * Initialize page with image number (index number of image in comic file)
+ * Reads page from attributes of a <Page> element, attributes that are missing or aren't valid are
+ * left unset, image is -1 if it's missing.
+ */
+Page Page::fromXml(const QXmlStreamAttributes &attributes) {
+	Page page;
+	bool ok;
+
+	for(const QXmlStreamAttribute &attribute : attributes) {
+		const QStringRef name	=	attribute.name();
+		const QStringRef value	=	attribute.value();
+
+		if(name == "Image") {
+			int image = value.toInt(&ok);
+			if(ok) page.image = image;
+		} else if(name == "Type") {
+			page.type = typeFromString(value.toString());
+		} else if(name == "DoublePage") {
+			page.setDoublePage(value.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0);
+		} else if(name == "ImageSize") {
+			qint64 image_size = value.toLongLong(&ok);
+			if(ok) page.image_size = image_size;
+		} else if(name == "Key") {
+			page.setKey(value.toString());
+		} else if(name == "ImageWidth") {
+			int image_width = value.toInt(&ok);
+			if(ok) page.image_width = image_width;
+		} else if(name == "ImageHeight") {
+			int image_height = value.toInt(&ok);
+			if(ok) page.image_height = image_height;
+		}
+	}
+
+	return page;
+}
+
+
+/**
+ * Returns Type of type string, unknown types are OTHER, an empty string is NO_TYPE.
+ */
+Page::Type Page::typeFromString(const QString &type) {
+	if(type.isEmpty()) return NO_TYPE;
+
+	for(int i = FRONT_COVER; i <= DELETED; i++) {
+		if(type == QLatin1String(type_name_list[i])) return Type(i);
+	}
+
+	return OTHER;
+}
+
+
+/**
+ * Returns type as it's written in XML, NO_TYPE is an empty string.
  */
-Page::Page(const QString &_image) {
-	image = MetadataTag("Image");
-	type = MetadataTag("Type");
-	double_page = MetadataTag("DoublePage");
-	image_size = MetadataTag("ImageSize");
-	key = MetadataTag("Key");
-	image_width = MetadataTag("ImageWidth");
-	image_height = MetadataTag("ImageHeight");
-
-	image.setValue(_image);
+QString Page::typeToString(const Type type) {
+	return QString(type_name_list[type]);
+}
+
+
+/**
+ * Writes page as a <Page/> element, only writing attributes that are set.
+ */
+void Page::writeXml(QXmlStreamWriter &writer, const QString &ns_uri) const {
+	writer.writeEmptyElement(ns_uri, "Page");
+	// Image is a required field, so it will always be filled
+	writer.writeAttribute(ns_uri, "Image", QString::number(image));
+
+	// For the rest, if they are unset don't add them
+	if(type != NO_TYPE) writer.writeAttribute(ns_uri, "Type", typeToString(getType()));
+	if(has_double_page) writer.writeAttribute(ns_uri, "DoublePage", double_page ? "true" : "false");
+	if(image_size != -1) writer.writeAttribute(ns_uri, "ImageSize", QString::number(image_size));
+	if(key != 0) writer.writeAttribute(ns_uri, "Key", getKey());
+	if(image_width != -1) writer.writeAttribute(ns_uri, "ImageWidth", QString::number(image_width));
+	if(image_height != -1) {
+		writer.writeAttribute(ns_uri, "ImageHeight", QString::number(image_height));
+	}
 }
 
 
 /**
  * Page basic getters
  */
-QString Page::getImage() const { return image.getValue(); }
-QString Page::getType() const { return type.getValue(); }
-QString Page::getDoublePage() const { return double_page.getValue(); }
-QString Page::getImageSize() const { return image_size.getValue(); }
-QString Page::getKey() const { return key.getValue(); }
-QString Page::getImageWidth() const { return image_width.getValue(); }
-QString Page::getImageHeight() const { return image_height.getValue(); }
+int Page::getImage() const { return image; }
+Page::Type Page::getType() const { return Type(type); }
+bool Page::hasDoublePage() const { return has_double_page; }
+bool Page::isDoublePage() const { return double_page; }
+qint64 Page::getImageSize() const { return image_size; }
+QString Page::getKey() const { return StringPool::get(key); }
+int Page::getImageWidth() const { return image_width; }
+int Page::getImageHeight() const { return image_height; }
 
 
 /**
  * Page basic setters
  */
-void Page::setImage(const QString &value) { image.setValue(value); }
-void Page::setType(const QString &value) { type.setValue(value); }
-void Page::setDoublePage(const QString &value) { double_page.setValue(value); }
-void Page::setImageSize(const QString &value) { image_size.setValue(value); }
-void Page::setKey(const QString &value) { key.setValue(value); }
-void Page::setImageWidth(const QString &value) { image_width.setValue(value); }
-void Page::setImageHeight(const QString &value) { image_height.setValue(value); }
+void Page::setImage(const int value) { image = value; }
+void Page::setType(const Type value) { type = value; }
+void Page::setImageSize(const qint64 value) { image_size = value; }
+void Page::setImageWidth(const int value) { image_width = value; }
+void Page::setImageHeight(const int value) { image_height = value; }
 
 
-Page & Page::operator=(const Page &page) {
-	image			=	page.image;
-	type			=	page.type;
-	double_page		=	page.double_page;
+void Page::setDoublePage(const bool value) {
+	has_double_page	=	true;
+	double_page		=	value;
+}
+
+
+void Page::setKey(const QString &value) {
+	quint32 id = StringPool::intern(value);
+	StringPool::release(key);
+	key = id;
+}
+
+
+/**
+ * Copies page, key is retained before the old one is released, in case they're the same.
+ */
+Page & Page::operator =(const Page &page) {
+	StringPool::retain(page.key);
+	StringPool::release(key);
+
 	image_size		=	page.image_size;
-	key				=	page.key;
+	image			=	page.image;
 	image_width		=	page.image_width;
 	image_height	=	page.image_height;
+	key				=	page.key;
+	type			=	page.type;
+	has_double_page	=	page.has_double_page;
+	double_page		=	page.double_page;
 
 	return *this;
 }
 
 
+bool Page::operator ==(const Page &page) const {
+	return
+		image == page.image && type == page.type && has_double_page == page.has_double_page &&
+		double_page == page.double_page && image_size == page.image_size && key == page.key &&
+		image_width == page.image_width && image_height == page.image_height;
+}
+
+
+bool Page::operator !=(const Page &page) const {
+	return !(*this == page);
+}
+
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  *									PAGELIST PUBLIC METHODS 									 *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 
 /**
- * Returns the index of page with type "FrontCover". If no pages have a type of "FrontCover" then
+ * Returns the index of page with type FRONT_COVER. If no pages have a type of FRONT_COVER then
  * just return 0 (we just assume the first image is the front cover).
  */
 int PageList::getFrontCover() const {
 	// Loop through pages checking for a FrontCover page
 	for(int i = 0; i < size(); i++) {
-		if((*this)[i].getType() == "FrontCover") {
+		if(at(i).getType() == Page::FRONT_COVER) {
 			return i;
 		}
 	}
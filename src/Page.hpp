@@ -21,64 +21,97 @@
 #define PAGE_HPP
 
 
-#include <QList>
+#include <QVector>
 
-#include "MetadataTag.hpp"
+#include "StringPool.hpp"
+
+
+class QXmlStreamAttributes;
+class QXmlStreamWriter;
 
 
 /**
- * This class contains metadata about a single page, each metadata is stored as a QString in this
- * object, but they have specific types they represent.
- *
- * Page Type Strings:
- * -"FrontCover"
- * -"InnerCover"
- * -"Roundup"
- * -"Story"
- * -"Advertisment"
- * -"Editorial"
- * -"Letters"
- * -"Preview"
- * -"BackCover"
- * -"Other"
- * -"Deleted"
+ * This class contains metadata about a single page, stored as plain typed fields in a small packed
+ * struct, so that a PageList is one contiguous array that's cheap to walk. Values are only
+ * converted to and from strings when reading or writing XML, with fromXml() and writeXml().
+ * Numbers that aren't set are -1.
  */
 class Page {
 	public:
-		Page() {}
+		/**
+		 * Page types, as strings in XML:
+		 * -"FrontCover"
+		 * -"InnerCover"
+		 * -"Roundup"
+		 * -"Story"
+		 * -"Advertisment"
+		 * -"Editorial"
+		 * -"Letters"
+		 * -"Preview"
+		 * -"BackCover"
+		 * -"Other"
+		 * -"Deleted"
+		 */
+		enum Type {
+			NO_TYPE,
+			FRONT_COVER,
+			INNER_COVER,
+			ROUNDUP,
+			STORY,
+			ADVERTISMENT,
+			EDITORIAL,
+			LETTERS,
+			PREVIEW,
+			BACK_COVER,
+			OTHER,
+			DELETED
+		};
+
+		Page();
 		Page(const Page &page);
-		Page(const QString &_image);
-		QString getImage() const;
-		QString getType() const;
-		QString getDoublePage() const;
-		QString getImageSize() const;
+		Page(const int _image);
+		~Page();
+		static Page fromXml(const QXmlStreamAttributes &attributes);
+		static Type typeFromString(const QString &type);
+		static QString typeToString(const Type type);
+		void writeXml(QXmlStreamWriter &writer, const QString &ns_uri = QString()) const;
+		int getImage() const;
+		Type getType() const;
+		bool hasDoublePage() const;
+		bool isDoublePage() const;
+		qint64 getImageSize() const;
 		QString getKey() const;
-		QString getImageWidth() const;
-		QString getImageHeight() const;
-		void setImage(const QString &value);
-		void setType(const QString &value);
-		void setDoublePage(const QString &value);
-		void setImageSize(const QString &value);
+		int getImageWidth() const;
+		int getImageHeight() const;
+		void setImage(const int value);
+		void setType(const Type value);
+		void setDoublePage(const bool value);
+		void setImageSize(const qint64 value);
 		void setKey(const QString &value);
-		void setImageWidth(const QString &value);
-		void setImageHeight(const QString &value);
-		Page & operator=(const Page &page);
+		void setImageWidth(const int value);
+		void setImageHeight(const int value);
+		Page & operator =(const Page &page);
+		bool operator ==(const Page &page) const;
+		bool operator !=(const Page &page) const;
 
 	private:
-		MetadataTag image; // <Image> tag in xml, represents image number in comic file as an int
-		MetadataTag type; // <Type>... value as 1 of 11 strings
-		MetadataTag double_page; // <DoublePage>... value as a bool
-		MetadataTag image_size; // <ImageSize>... value as a long
-		MetadataTag key; // <Key>... value as a string
-		MetadataTag image_width; // <ImageWidth>... value as an int
-		MetadataTag image_height; // <ImageHeight>... value as an int
+		qint64 image_size		=	-1; // <ImageSize>, size of image in bytes
+		qint32 image			=	-1; // <Image>, image number in comic file
+		qint32 image_width		=	-1; // <ImageWidth>
+		qint32 image_height		=	-1; // <ImageHeight>
+		quint32 key				=	0; // <Key>, held StringPool id
+		quint8 type				:	4; // <Type>, as Type
+		quint8 has_double_page	:	1; // <DoublePage> was set
+		quint8 double_page		:	1; // <DoublePage>
 };
 
+Q_DECLARE_TYPEINFO(Page, Q_MOVABLE_TYPE);
+
 
 /**
- * PageList is just a QList of Pages.
+ * PageList is just a QVector of Pages, Pages are stored inline rather than allocated one by one.
  */
-class PageList : public QList<Page> {
+class PageList : public QVector<Page> {
 	public:
 		int getFrontCover() const;
 };
@@ -35,7 +35,7 @@ PageListView::~PageListView() {
  * After pages are extracted the PageListModel is populated for pages to be displayed.
  */
 bool PageListView::init() {
-	const PageList &page_list = comic.info.page_list;
+	const PageList &page_list = comic.info.getPageList();
 	QProgressDialog progress_dialog(tr("Extracting pages..."), tr("Cancel"), 0, page_list.size(),
 		this);
 	progress_dialog.setWindowModality(Qt::WindowModal);
@@ -43,8 +43,8 @@ bool PageListView::init() {
 
 	int i = 0;
 	for(const Page &page : page_list) {
-		comic.extractPage(page.getImage().toInt(), config->getTempDir().absolutePath(),
-			page.getImage() + ".jpg", 128);
+		comic.extractPage(page.getImage(), config->getTempDir().absolutePath(),
+			QString::number(page.getImage()) + ".jpg", 128);
 
 		progress_dialog.setValue(++i);
 		if(progress_dialog.wasCanceled()) break;
@@ -59,7 +59,7 @@ bool PageListView::init() {
 		return false;
 	} else {
 		// Else populate model with page images
-		model = new PageListModel(comic.info.page_list, this);
+		model = new PageListModel(comic.info.editPageList(), this);
 		setModel(model);
 		initialized = true;
 
@@ -82,11 +82,12 @@ QVariant PageListView::PageListModel::data(const QModelIndex &index, int role) c
 
 	if(role == Qt::DecorationRole) {
 		return QIcon(config->getTempDir().absolutePath() + "/" +
-			list.at(index.row()).getImage() + ".jpg");
+			QString::number(list.at(index.row()).getImage()) + ".jpg");
 	} else if(role == Qt::DisplayRole) {
-		QString caption = QString("Image ") + list.at(index.row()).getImage() + ".";
-		if(!list.at(index.row()).getType().isEmpty()) {
-			caption.append(QString(" ") + list.at(index.row()).getType());
+		const Page &page = list.at(index.row());
+		QString caption = QString("Image ") + QString::number(page.getImage()) + ".";
+		if(page.getType() != Page::NO_TYPE) {
+			caption.append(QString(" ") + Page::typeToString(page.getType()));
 		}
 
 		return caption;
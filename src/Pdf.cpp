@@ -63,12 +63,49 @@ bool Pdf::hasComicInfo() const {
 
 
 /**
- * Get xmp packet from ComicInfo metadata object, and return as a QString, if it doesn't exist then
- * QString will be null.
+ * Returns fingerprint of pdf's pages, an md5 hash of each page's content and image streams as they
+ * are stored (they aren't decoded), it doesn't change when only the ComicInfo object is changed.
+ *
+ * Possible Exceptions:
+ * - PDF_ERROR may be thrown if PoDoFo fails to load pdf.
+ */
+QByteArray Pdf::getContentHash() const {
+	QCryptographicHash hash(QCryptographicHash::Md5);
+
+	try {
+		PoDoFo::PdfMemDocument mem_doc(path.toLocal8Bit().data());
+
+		for(int i = 0; i < mem_doc.GetPageCount(); i++) {
+			PoDoFo::PdfPage *page = mem_doc.GetPage(i);
+			addStreams(hash, mem_doc, page->GetContents());
+
+			// Images and forms drawn by page
+			PoDoFo::PdfObject *resources = page->GetResources();
+			if(resources == nullptr || !resources->IsDictionary()) continue;
+
+			PoDoFo::PdfObject *xobjects = resources->GetIndirectKey(PoDoFo::PdfName("XObject"));
+			if(xobjects == nullptr || !xobjects->IsDictionary()) continue;
+
+			for(const auto &key : xobjects->GetDictionary().GetKeys()) {
+				addStreams(hash, mem_doc, key.second);
+			}
+		}
+	} catch(const PoDoFo::PdfError &) {
+		throw eComics::Exception(eComics::PDF_ERROR, "Pdf::getContentHash()",
+				QString("PoDoFo failed to read ") + path);
+	}
+
+	return hash.result().toHex();
+}
+
+
+/**
+ * Get xmp packet from ComicInfo metadata object, and return it raw, if it doesn't exist then
+ * QByteArray will be null.
  */
-QString Pdf::getXmlBuf() const {
+QByteArray Pdf::getXmlBuf() const {
 	PoDoFo::PdfMemDocument mem_doc(path.toLocal8Bit().data());
-	QString xmp_str;
+	QByteArray xml_buf;
 
 	// Check if ComicInfo exists and has a stream
 	if(mem_doc.GetCatalog()->GetDictionary().HasKey(PoDoFo::PdfName("ComicInfo"))) {
@@ -82,14 +119,14 @@ QString Pdf::getXmlBuf() const {
 
 			// Get PdfStream from Metadata object, and write the stream to the ouput buffer
 			xmp_obj->GetStream()->GetFilteredCopy(&xmp_buf, &xmp_len);
-			// Create QString from xmp_buf
-			xmp_str = QString(xmp_buf);
+			// Copy xmp_buf, it isn't null terminated
+			xml_buf = QByteArray(xmp_buf, xmp_len);
 			// Free xmp_buf
 			free(xmp_buf);
 		}
 	}
 
-	return xmp_str;
+	return xml_buf;
 }
 
 
@@ -132,7 +169,7 @@ void Pdf::setComicInfo(const QByteArray &raw_xmp) {
 
 
 /**
- * Extract page at index to temp dir, returns full path of extracted page.
+ * Extract page at index to dir_path, returns full path of extracted page.
  *
  * Possible Exceptions:
  * - PDF_ERROR may be thrown if Poppler fails to load file, if pdf is locked, or if Poppler fails
@@ -140,8 +177,8 @@ void Pdf::setComicInfo(const QByteArray &raw_xmp) {
  * - LOGIC_ERROR may be thrown if page at index doesn't exist.
  * - FILE_ERROR may be thrown if writing page to image file fails.
  */
-QString Pdf::extractPage(const int index) const {
-	QString new_path = config->getTempDir().absolutePath() + "/extracted_image.jpg";
+QString Pdf::extractPage(const int index, const QString &dir_path) const {
+	QString new_path = dir_path + "/extracted_image.jpg";
 
 	// Open document in poppler
 	Poppler::Document *pop_doc = Poppler::Document::load(path);
@@ -180,4 +217,37 @@ QString Pdf::extractPage(const int index) const {
 	delete pdf_page;
 	delete pop_doc;
 	return new_path;
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *										PDF PRIVATE METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Adds raw stream of obj to hash, following references, if obj is an array then each of it's items
+ * is added.
+ */
+void Pdf::addStreams(QCryptographicHash &hash, PoDoFo::PdfMemDocument &mem_doc,
+		PoDoFo::PdfObject *obj) {
+	if(obj != nullptr && obj->IsReference()) {
+		obj = mem_doc.GetObjects().GetObject(obj->GetReference());
+	}
+
+	if(obj == nullptr) return;
+
+	if(obj->IsArray()) {
+		PoDoFo::PdfArray &array = obj->GetArray();
+		for(size_t i = 0; i < array.size(); i++) addStreams(hash, mem_doc, &array[i]);
+	}
+
+	else if(obj->HasStream()) {
+		char *buf;
+		PoDoFo::pdf_long len;
+
+		obj->GetStream()->GetCopy(&buf, &len);
+		hash.addData(buf, len);
+		free(buf);
+	}
 }
\ No newline at end of file
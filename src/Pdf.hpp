@@ -27,6 +27,7 @@
 #include <QDebug>
 #include <QImage>
 #include <QFile>
+#include <QCryptographicHash>
 
 #include "Exceptions.hpp"
 #include "Config.hpp"
@@ -44,12 +45,16 @@ class Pdf {
 		~Pdf();
 		int getNumOfPages() const;
 		bool hasComicInfo() const;
-		QString getXmlBuf() const;
+		QByteArray getContentHash() const;
+		QByteArray getXmlBuf() const;
 		void setComicInfo(const QByteArray &raw_xmp);
-		QString extractPage(const int index) const;
+		QString extractPage(const int index, const QString &dir_path) const;
 
 	private:
 		QString path;
+
+		static void addStreams(QCryptographicHash &hash, PoDoFo::PdfMemDocument &mem_doc,
+				PoDoFo::PdfObject *obj);
 };
 
 
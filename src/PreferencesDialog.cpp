@@ -13,6 +13,7 @@
 #include "HelpButton.hpp"
 #include "Library.hpp"
 #include "LibraryView.hpp"
+#include "LibraryWatcher.hpp"
 #include "MainSidePane.hpp"
 
 
@@ -139,6 +140,7 @@ void PreferencesDialog::onFinished(const int result) {
 
 		// Save config to file
 		config->save();
+		if(library_watcher != nullptr) library_watcher->reset();
 
 		// If manage files is enabled, then cleanup files
 		if(config->manageFiles()) {
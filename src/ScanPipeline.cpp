@@ -0,0 +1,182 @@
+#include "ScanPipeline.hpp"
+
+#include <chrono>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "ComicFile.hpp"
+#include "Exceptions.hpp"
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									SCANPIPELINE PUBLIC METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Starts all stages, paths can be pushed right away.
+ */
+ScanPipeline::ScanPipeline(const CommitCallback &_commit, const int _batch_size)
+		: commit(_commit), batch_size(_batch_size), num_of_comics(0) {
+	int num_of_cores = qMax(1, QThread::idealThreadCount());
+
+	// Stat input is large so a directory walker rarely blocks, the rest only need to be big enough
+	// to keep the next stage busy, ComicFiles in flight are not small
+	queue[STAT_STAGE]			=	new BoundedQueue<ScanItem *>(1024);
+	queue[FINGERPRINT_STAGE]	=	new BoundedQueue<ScanItem *>(64);
+	queue[PROBE_STAGE]			=	new BoundedQueue<ScanItem *>(2 * num_of_cores);
+	queue[NUM_OF_STAGES]		=	new BoundedQueue<ScanItem *>(2 * batch_size);
+
+	startStage(STAT_STAGE, 2);
+	startStage(FINGERPRINT_STAGE, 2);
+	startStage(PROBE_STAGE, num_of_cores);
+	commit_thread = std::thread(&ScanPipeline::runCommit, this);
+}
+
+
+ScanPipeline::~ScanPipeline() {
+	finish();
+	for(int i = 0; i <= NUM_OF_STAGES; i++) delete queue[i];
+}
+
+
+/**
+ * Queues path to be imported, blocks while stat stage is full. Thread safe. If file_stat is already
+ * known (e.g. from DirWalker) then it isn't stat'd again.
+ */
+void ScanPipeline::push(const QString &path, const FileStat &file_stat) {
+	queue[STAT_STAGE]->push(new ScanItem{path, file_stat, QByteArray(), nullptr});
+}
+
+
+/**
+ * Call once all paths have been pushed, blocks until every stage is done and the last batch has
+ * been committed.
+ */
+void ScanPipeline::finish() {
+	if(finished) return;
+	finished = true;
+
+	queue[STAT_STAGE]->close();
+	for(int i = 0; i < NUM_OF_STAGES; i++) {
+		for(std::thread &thread : stage[i].thread_list) thread.join();
+	}
+	commit_thread.join();
+}
+
+
+/**
+ * Returns number of comics that made it through every stage.
+ */
+int ScanPipeline::getNumOfComics() const { return num_of_comics; }
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									SCANPIPELINE PRIVATE METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+void ScanPipeline::startStage(const int index, const int num_of_workers) {
+	stage[index].running = num_of_workers;
+	for(int i = 0; i < num_of_workers; i++) {
+		stage[index].thread_list.emplace_back(&ScanPipeline::runStage, this, index);
+	}
+}
+
+
+/**
+ * Worker loop for stage at index, items that fail are dropped rather than passed on.
+ */
+void ScanPipeline::runStage(const int index) {
+	ScanItem *item;
+
+	while(queue[index]->pop(item)) {
+		if(process(index, item)) queue[index + 1]->push(item);
+		else deleteItem(item);
+	}
+
+	if(--stage[index].running == 0) queue[index + 1]->close();
+}
+
+
+/**
+ * Does the work of stage at index on item, returns false if item should be dropped.
+ */
+bool ScanPipeline::process(const int index, ScanItem *item) {
+	try {
+		switch(index) {
+			case STAT_STAGE:
+				if(!ComicFile::isSupportedType(item->path)) return false;
+				if(item->file_stat.isNull()) item->file_stat = FileStat::fromPath(item->path);
+				return item->file_stat.isFile();
+
+			case FINGERPRINT_STAGE:
+				item->md5_hash = ComicFile::generateMd5Hash(item->path);
+				return true;
+
+			// Comic is only read until it's copied into library, so it's passed along as is, and
+			// cover is only queued with ThumbnailService, which copies nothing but what reads it
+			case PROBE_STAGE:
+				item->comic = new ComicFile(item->path, item->md5_hash, item->file_stat);
+				if(item->comic->isNull()) return false;
+				item->comic->verifyThumb();
+				return true;
+		}
+	} catch(const eComics::Exception &e) { e.printMsg(); }
+
+	return false;
+}
+
+
+/**
+ * Collects finished comics into batches, a batch is committed when it's full, or when nothing has
+ * finished for a while so that imports show up even when stages are slow.
+ */
+void ScanPipeline::runCommit() {
+	BoundedQueue<ScanItem *> *input = queue[NUM_OF_STAGES];
+	QList<ComicFile *> batch;
+	QElapsedTimer idle_timer;
+	ScanItem *item;
+
+	idle_timer.start();
+
+	while(true) {
+		if(input->tryPop(item)) {
+			batch << item->comic;
+			delete item;
+			if(batch.size() >= batch_size) commitBatch(batch);
+			idle_timer.restart();
+			continue;
+		}
+
+		// Check again after seeing closed, an item may have been pushed just before close()
+		if(input->isClosed()) {
+			if(!input->tryPop(item)) break;
+			batch << item->comic;
+			delete item;
+			continue;
+		}
+
+		if(!batch.isEmpty() && idle_timer.elapsed() > 500) commitBatch(batch);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	commitBatch(batch);
+}
+
+
+void ScanPipeline::commitBatch(QList<ComicFile *> &batch) {
+	if(batch.isEmpty()) return;
+
+	num_of_comics += batch.size();
+	commit(batch);
+	qDeleteAll(batch);
+	batch.clear();
+}
+
+
+void ScanPipeline::deleteItem(ScanItem *item) {
+	delete item->comic;
+	delete item;
+}
\ No newline at end of file
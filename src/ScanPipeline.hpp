@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * ScanPipeline.hpp                                                            *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef SCANPIPELINE_HPP
+#define SCANPIPELINE_HPP
+
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <QList>
+
+#include "BoundedQueue.hpp"
+#include "FileStat.hpp"
+
+
+class ComicFile;
+
+
+/**
+ * class ScanPipeline
+ *
+ * Imports new comics in stages that run at the same time, each on it's own threads:
+ *
+ * - Stat: filters out unsupported files, and stats the rest (skipped if stat is already known).
+ * - Fingerprint: generates md5 hash, disk bound, so only a couple of threads.
+ * - Probe: lists archive and reads ComicInfo (constructs ComicFile), one thread per core. Covers
+ * are left to ThumbnailService, so imports never wait on them.
+ *
+ * Stages are connected by BoundedQueues, so a fast stage blocks instead of running ahead of a slow
+ * one. Finished comics are passed to the commit callback in batches (from the pipeline's commit
+ * thread) so that Library is only updated once per batch. The ComicFiles passed to commit are
+ * deleted after it returns, so it must copy them. They're never copied or connected to their info
+ * before then, so the pipeline's threads make no QObject connections of their own.
+ */
+class ScanPipeline {
+	public:
+		typedef std::function<void(const QList<ComicFile *> &batch)> CommitCallback;
+
+		ScanPipeline(const CommitCallback &_commit, const int _batch_size = 64);
+		~ScanPipeline();
+		void push(const QString &path, const FileStat &file_stat = FileStat());
+		void finish();
+		int getNumOfComics() const;
+
+	private:
+		struct ScanItem {
+			QString path;
+			FileStat file_stat;
+			QByteArray md5_hash;
+			ComicFile *comic;
+		};
+
+		enum StageType {
+			STAT_STAGE,
+			FINGERPRINT_STAGE,
+			PROBE_STAGE,
+			NUM_OF_STAGES
+		};
+
+		struct Stage {
+			std::atomic<int> running; // Workers still running, last one closes output queue
+			std::vector<std::thread> thread_list;
+		};
+
+		CommitCallback commit;
+		int batch_size;
+		// queue[i] is input of stage i, the last queue is input of commit thread
+		BoundedQueue<ScanItem *> *queue[NUM_OF_STAGES + 1];
+		Stage stage[NUM_OF_STAGES];
+		std::thread commit_thread;
+		std::atomic<int> num_of_comics;
+		bool finished = false;
+
+		void startStage(const int index, const int num_of_workers);
+		void runStage(const int index);
+		bool process(const int index, ScanItem *item);
+		void runCommit();
+		void commitBatch(QList<ComicFile *> &batch);
+		void deleteItem(ScanItem *item);
+};
+
+
+#endif
\ No newline at end of file
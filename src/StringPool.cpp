@@ -0,0 +1,137 @@
+#include "StringPool.hpp"
+
+#include "Exceptions.hpp"
+
+
+std::atomic<StringPool::Entry *> StringPool::chunk_list[StringPool::MAX_CHUNKS]; // All null
+QHash<QString, quint32> StringPool::id_hash;
+QVector<quint32> StringPool::free_id_list;
+quint32 StringPool::next_id = 1; // Id 0 is reserved for the empty string
+std::atomic<quint32> StringPool::num_of_strings(0);
+qint64 StringPool::num_of_chars = 0;
+QMutex StringPool::mutex;
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									STRINGPOOL PUBLIC METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Returns id of string, adding it to pool if it isn't there yet. The id holds a reference to string
+ * that must be released, unless it's 0.
+ *
+ * Possible Exceptions:
+ * - LOGIC_ERROR may be thrown if pool is full.
+ */
+quint32 StringPool::intern(const QString &string) {
+	if(string.isEmpty()) return 0;
+
+	QMutexLocker locker(&mutex);
+
+	// A string whose last reference is being released may be found here, it's kept if so
+	auto iter = id_hash.constFind(string);
+	if(iter != id_hash.constEnd()) {
+		entry(iter.value()).num_of_refs.fetch_add(1, std::memory_order_relaxed);
+		return iter.value();
+	}
+
+	quint32 id;
+	if(!free_id_list.isEmpty()) id = free_id_list.takeLast();
+	else {
+		id = next_id;
+		int chunk = id >> CHUNK_BITS;
+
+		if(chunk >= MAX_CHUNKS) {
+			throw eComics::Exception(eComics::LOGIC_ERROR, "StringPool::intern()",
+					"String pool is full");
+		}
+
+		// Publish chunk, get() on other threads acquires it along with it's id
+		if(chunk_list[chunk].load(std::memory_order_relaxed) == nullptr) {
+			chunk_list[chunk].store(new Entry[CHUNK_SIZE], std::memory_order_release);
+		}
+
+		next_id++;
+	}
+
+	Entry &new_entry = entry(id);
+	new_entry.string = string;
+	new_entry.num_of_refs.store(1, std::memory_order_release);
+	id_hash.insert(string, id);
+	num_of_chars += string.size();
+	num_of_strings++;
+
+	return id;
+}
+
+
+/**
+ * Adds a reference to string with id, for another copy of id being stored.
+ */
+void StringPool::retain(const quint32 id) {
+	if(id == 0) return;
+	entry(id).num_of_refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/**
+ * Drops a reference to string with id, string is dropped along with the last one.
+ */
+void StringPool::release(const quint32 id) {
+	if(id == 0) return;
+
+	Entry &old_entry = entry(id);
+	if(old_entry.num_of_refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+	// intern() may have found it again before the lock was taken, or another release() that
+	// raced with one of those dropped it already
+	QMutexLocker locker(&mutex);
+	if(old_entry.num_of_refs.load(std::memory_order_acquire) != 0 || old_entry.string.isNull()) {
+		return;
+	}
+
+	id_hash.remove(old_entry.string);
+	num_of_chars -= old_entry.string.size();
+	num_of_strings--;
+	old_entry.string = QString();
+	free_id_list << id;
+}
+
+
+/**
+ * Returns string with id, id must be held (returned by intern() or retained) by the caller.
+ */
+QString StringPool::get(const quint32 id) {
+	if(id == 0) return QString();
+	return entry(id).string;
+}
+
+
+int StringPool::getNumOfStrings() {
+	return num_of_strings;
+}
+
+
+/**
+ * Returns approximate number of bytes used by pool, string data, chunks, and hash.
+ */
+qint64 StringPool::getMemoryUsage() {
+	QMutexLocker locker(&mutex);
+
+	qint64 num_of_chunks = (next_id + CHUNK_SIZE - 1) >> CHUNK_BITS;
+	return
+		num_of_chars * sizeof(QChar) + num_of_strings * 24 + // String data and headers
+		num_of_chunks * CHUNK_SIZE * sizeof(Entry) + free_id_list.capacity() * sizeof(quint32) +
+		id_hash.capacity() * (sizeof(void *) + sizeof(QString) + sizeof(quint32) + sizeof(uint));
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									STRINGPOOL PRIVATE METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+StringPool::Entry & StringPool::entry(const quint32 id) {
+	return chunk_list[id >> CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE - 1)];
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * StringPool.hpp                                                              *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef STRINGPOOL_HPP
+#define STRINGPOOL_HPP
+
+
+#include <atomic>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+
+/**
+ * class StringPool
+ *
+ * Interns strings, each distinct string is stored once and referred to by a 32 bit id, so that
+ * values repeated across comics (publisher, series, creators, genre, format, language, page types,
+ * etc.) only cost 4 bytes each. Id 0 is always the empty string.
+ *
+ * Strings are reference counted. intern() returns an id holding one reference, whoever stores the
+ * id (ComicInfo, Page) retain()s it for each copy, and release()s it when done. Once the last
+ * reference is released the string is dropped and it's id is reused.
+ *
+ * Strings live in fixed size chunks that never move once allocated, chunks are published with
+ * release/acquire ordering, so get() doesn't need to lock, only intern() and dropping a string do.
+ * Safe to use from any thread.
+ */
+class StringPool {
+	public:
+		static quint32 intern(const QString &string);
+		static void retain(const quint32 id);
+		static void release(const quint32 id);
+		static QString get(const quint32 id);
+		static int getNumOfStrings();
+		static qint64 getMemoryUsage();
+
+	private:
+		static const int CHUNK_BITS	=	12;
+		static const int CHUNK_SIZE	=	1 << CHUNK_BITS;
+		static const int MAX_CHUNKS	=	4096;
+
+		struct Entry {
+			QString string; // Null once dropped
+			std::atomic<quint32> num_of_refs{0};
+		};
+
+		static std::atomic<Entry *> chunk_list[MAX_CHUNKS];
+		static QHash<QString, quint32> id_hash;
+		static QVector<quint32> free_id_list; // Ids of dropped strings, reused first
+		static quint32 next_id; // Lowest id never handed out
+		static std::atomic<quint32> num_of_strings;
+		static qint64 num_of_chars;
+		static QMutex mutex;
+
+		static Entry & entry(const quint32 id);
+};
+
+
+#endif
\ No newline at end of file
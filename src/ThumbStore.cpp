@@ -0,0 +1,292 @@
+#include "ThumbStore.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <QBuffer>
+#include <QDebug>
+#include <QSaveFile>
+
+#include "Exceptions.hpp"
+
+
+const double ThumbStore::MAX_GARBAGE_RATIO = 0.25;
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									THUMBSTORE PUBLIC METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Opens store at path, creating it if it doesn't exist.
+ */
+ThumbStore::ThumbStore(const QString &_path) : path(_path) {
+	QMutexLocker locker(&mutex);
+	open();
+}
+
+
+ThumbStore::~ThumbStore() {
+	QMutexLocker locker(&mutex);
+	close();
+}
+
+
+bool ThumbStore::contains(const QByteArray &cover_hash, const int size) const {
+	QMutexLocker locker(&mutex);
+	return index.contains(Key(cover_hash, size));
+}
+
+
+/**
+ * Returns thumbnail of cover with cover_hash at size, or a null QImage if it isn't in store. A
+ * RAW_FORMAT thumbnail points straight into the mapped store, so it should be converted (e.g. to a
+ * QPixmap) or copied rather than kept. compact() doesn't unmap the store while one is still alive.
+ */
+QImage ThumbStore::get(const QByteArray &cover_hash, const int size) const {
+	QMutexLocker locker(&mutex);
+
+	auto iter = index.find(Key(cover_hash, size));
+	if(iter == index.end()) return QImage();
+
+	const Header *header = headerAt(iter.value());
+	if(header == nullptr) return QImage();
+
+	const uchar *data = reinterpret_cast<const uchar *>(header + 1);
+	if(header->format == RAW_FORMAT) {
+		num_of_raw_images++;
+		return QImage(data, header->width, header->height, header->width * 4,
+				QImage::Format_RGB32, releaseRawImage, const_cast<ThumbStore *>(this));
+	} else return QImage::fromData(data, header->data_size, "JPEG");
+}
+
+
+/**
+ * Appends thumbnail of cover with cover_hash at size, replacing any thumbnail already stored for
+ * it.
+ *
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if image fails to be encoded, or if store fails to be written.
+ */
+void ThumbStore::put(const QByteArray &cover_hash, const int size, const QImage &image,
+		const Format format) {
+	// Encode outside of lock, only appending needs it
+	QByteArray data;
+	if(format == RAW_FORMAT) {
+		QImage raw_image = image.convertToFormat(QImage::Format_RGB32);
+		data = QByteArray(reinterpret_cast<const char *>(raw_image.constBits()),
+				raw_image.byteCount());
+	} else {
+		QBuffer buffer(&data);
+		buffer.open(QIODevice::WriteOnly);
+		if(!image.save(&buffer, "JPEG")) {
+			throw eComics::Exception(eComics::FILE_ERROR, "ThumbStore::put()",
+					QString("Failed to encode thumbnail of ") + cover_hash);
+		}
+	}
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic		=	MAGIC;
+	header.data_size	=	data.size();
+	header.size			=	size;
+	header.format		=	format;
+	header.width		=	image.width();
+	header.height		=	image.height();
+	std::memcpy(header.cover_hash, cover_hash.constData(),
+			qMin(cover_hash.size(), int(sizeof(header.cover_hash))));
+
+	data.append(QByteArray(recordSize(header) - sizeof(header) - data.size(), '\0'));
+
+	QMutexLocker locker(&mutex);
+
+	qint64 offset = append_file.size();
+	qint64 header_size = append_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	if(header_size != sizeof(header) || append_file.write(data) != data.size() ||
+			!append_file.flush()) {
+		// Drop partial record, so the next one starts where it should
+		append_file.resize(offset);
+		throw eComics::Exception(eComics::FILE_ERROR, "ThumbStore::put()",
+				QString("Failed to write to ") + path);
+	}
+
+	Key key(cover_hash, size);
+	auto iter = index.find(key);
+	if(iter != index.end()) {
+		const Header *old_header = headerAt(iter.value());
+		if(old_header != nullptr) garbage_size += recordSize(*old_header);
+	}
+
+	index.insert(key, offset);
+}
+
+
+/**
+ * Drops replaced records, and records of covers that aren't in live_cover_hashes, by rewriting
+ * store. Only done once garbage passes MAX_GARBAGE_RATIO of store, since it copies every record.
+ * Skipped while a RAW_FORMAT thumbnail returned by get() is alive, since it points into the
+ * mappings, it's done on a later call instead.
+ *
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if new store fails to be written.
+ */
+void ThumbStore::compact(const QSet<QByteArray> &live_cover_hashes) {
+	QMutexLocker locker(&mutex);
+
+	qint64 store_size = file.size();
+	qint64 live_size = 0;
+	QList<qint64> live_offset_list;
+
+	for(auto iter = index.constBegin(); iter != index.constEnd(); ++iter) {
+		const Header *header = headerAt(iter.value());
+		if(header == nullptr || !live_cover_hashes.contains(iter.key().first)) continue;
+
+		live_offset_list << iter.value();
+		live_size += recordSize(*header);
+	}
+
+	if(store_size - live_size <= store_size * MAX_GARBAGE_RATIO) return;
+
+	if(num_of_raw_images > 0) {
+		qDebug() << "Thumbnail store not compacted," << num_of_raw_images << "thumbnails in use";
+		return;
+	}
+
+	QSaveFile new_file(path);
+	if(!new_file.open(QIODevice::WriteOnly)) {
+		throw eComics::Exception(eComics::FILE_ERROR, "ThumbStore::compact()",
+				QString("Failed to open ") + path + " for writing");
+	}
+
+	// Keep records in the order they were written
+	std::sort(live_offset_list.begin(), live_offset_list.end());
+	for(qint64 offset : live_offset_list) {
+		const Header *header = headerAt(offset);
+		new_file.write(reinterpret_cast<const char *>(header), recordSize(*header));
+	}
+
+	// Mappings must be gone before store is replaced
+	close();
+	bool committed = new_file.commit();
+	open();
+
+	if(!committed) {
+		throw eComics::Exception(eComics::FILE_ERROR, "ThumbStore::compact()",
+				QString("Failed to write ") + path);
+	}
+
+	qDebug() << "Compacted thumbnail store from" << store_size / 1024 << "KiB to" <<
+			live_size / 1024 << "KiB";
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *									THUMBSTORE PRIVATE METHODS 									 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Opens and maps store, and builds index by walking record headers. A record that's cut short (or
+ * corrupt) and everything after it is truncated. Mutex must be locked.
+ */
+void ThumbStore::open() {
+	file.setFileName(path);
+	append_file.setFileName(path);
+
+	if(!append_file.open(QIODevice::Append) || !file.open(QIODevice::ReadOnly)) {
+		qDebug() << "ThumbStore::open() failed to open" << path;
+		return;
+	}
+
+	qint64 store_size = file.size();
+	mapTo(store_size);
+
+	qint64 offset = 0;
+	while(offset + qint64(sizeof(Header)) <= mapped_size) {
+		const Header *header = headerAt(offset);
+		if(header->magic != MAGIC || offset + recordSize(*header) > mapped_size) break;
+
+		Key key(QByteArray(header->cover_hash, sizeof(header->cover_hash)), header->size);
+		auto iter = index.find(key);
+		if(iter != index.end()) garbage_size += recordSize(*headerAt(iter.value()));
+		index.insert(key, offset);
+
+		offset += recordSize(*header);
+	}
+
+	if(offset < store_size) {
+		qDebug() << "Truncating thumbnail store" << path << "to" << offset << "bytes";
+		for(uchar *address : segment_map) file.unmap(address);
+		segment_map.clear();
+		mapped_size = 0;
+
+		append_file.resize(offset);
+		mapTo(offset);
+	}
+}
+
+
+/**
+ * Unmaps and closes store, and clears index. Mutex must be locked.
+ */
+void ThumbStore::close() {
+	for(uchar *address : segment_map) file.unmap(address);
+	segment_map.clear();
+	mapped_size	=	0;
+	garbage_size	=	0;
+	index.clear();
+
+	file.close();
+	append_file.close();
+}
+
+
+/**
+ * Returns header of record at offset, mapping the rest of store if it hasn't been mapped yet, or
+ * nullptr if offset is past the end of store. Mutex must be locked.
+ */
+const ThumbStore::Header * ThumbStore::headerAt(const qint64 offset) const {
+	if(offset + qint64(sizeof(Header)) > mapped_size) mapTo(file.size());
+	if(offset + qint64(sizeof(Header)) > mapped_size) return nullptr;
+
+	// Records never span segments, since store is only mapped up to the end of a whole record
+	auto segment = segment_map.upperBound(offset);
+	--segment;
+	return reinterpret_cast<const Header *>(segment.value() + (offset - segment.key()));
+}
+
+
+/**
+ * Maps store up to size, as a new segment, segments already mapped are left alone so thumbnails
+ * pointing into them stay valid. Mutex must be locked.
+ */
+void ThumbStore::mapTo(const qint64 size) const {
+	if(size <= mapped_size) return;
+
+	uchar *address = file.map(mapped_size, size - mapped_size);
+	if(address == nullptr) {
+		qDebug() << "ThumbStore::mapTo() failed to map" << path << file.errorString();
+		return;
+	}
+
+	segment_map.insert(mapped_size, address);
+	mapped_size = size;
+}
+
+
+/**
+ * Returns size of record with header, including header and padding, records are padded to 8 bytes
+ * so that every header and image is aligned.
+ */
+qint64 ThumbStore::recordSize(const Header &header) {
+	return sizeof(Header) + ((qint64(header.data_size) + 7) & ~qint64(7));
+}
+
+
+/**
+ * Cleanup function of RAW_FORMAT images returned by get(), called once the last copy sharing their
+ * data is gone.
+ */
+void ThumbStore::releaseRawImage(void *store) {
+	static_cast<ThumbStore *>(store)->num_of_raw_images--;
+}
\ No newline at end of file
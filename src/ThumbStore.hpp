@@ -0,0 +1,100 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * ThumbStore.hpp                                                              *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef THUMBSTORE_HPP
+#define THUMBSTORE_HPP
+
+
+#include <atomic>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QString>
+
+
+/**
+ * class ThumbStore
+ *
+ * Packs every thumbnail into one file (thumbs.dat in the thumbnail dir), instead of one JPEG each.
+ * Records are appended, each one is a fixed header followed by it's image, and the file is mmapped,
+ * so a RAW_FORMAT record is handed to QImage as is, without decoding it or a syscall per
+ * thumbnail. JPEG_FORMAT records are for large thumbnails, which would take too much space
+ * undecoded.
+ *
+ * Records are keyed by cover hash and size. The index is built by walking the record headers when
+ * the store is opened, so there's no separate index file to get out of sync, and a record that was
+ * cut short by a crash is simply truncated. Replaced records and records of covers no longer in
+ * library are left as garbage until compact() rewrites the store. Safe to use from any thread.
+ */
+class ThumbStore {
+	public:
+		enum Format {
+			RAW_FORMAT, // Pixels as QImage::Format_RGB32
+			JPEG_FORMAT
+		};
+
+		ThumbStore(const QString &_path);
+		~ThumbStore();
+		bool contains(const QByteArray &cover_hash, const int size) const;
+		QImage get(const QByteArray &cover_hash, const int size) const;
+		void put(const QByteArray &cover_hash, const int size, const QImage &image,
+				const Format format);
+		void compact(const QSet<QByteArray> &live_cover_hashes);
+
+	private:
+		static const quint32 MAGIC = 0x68544365; // "eCTh"
+		static const double MAX_GARBAGE_RATIO; // compact() only rewrites store past this ratio
+
+		struct Header {
+			quint32 magic;
+			quint32 data_size; // Bytes of image data, not including padding to 8 bytes
+			char cover_hash[32]; // Md5 hash as hex
+			quint16 size; // Size requested, largest side of image is at most this
+			quint16 format;
+			quint16 width;
+			quint16 height;
+		};
+
+		typedef QPair<QByteArray, int> Key; // Cover hash and size
+
+		QString path;
+		mutable QFile file; // Read only, mapped in segments as it grows
+		QFile append_file;
+		mutable QMap<qint64, uchar *> segment_map; // Mapped address by offset of segment in file
+		mutable qint64 mapped_size = 0; // Bytes of file that are mapped, always whole records
+		QHash<Key, qint64> index; // Offset of each record's header
+		qint64 garbage_size = 0; // Bytes of records that have been replaced
+		mutable std::atomic<int> num_of_raw_images{0}; // Alive from get(), compact() waits for none
+		mutable QMutex mutex;
+
+		void open();
+		void close();
+		const Header * headerAt(const qint64 offset) const;
+		void mapTo(const qint64 size) const;
+		static qint64 recordSize(const Header &header);
+		static void releaseRawImage(void *store);
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include "ThumbnailService.hpp"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QImage>
+#include <QThread>
+
+#include "Config.hpp"
+#include "Exceptions.hpp"
+#include "ImageScaler.hpp"
+
+
+ThumbnailService *thumbnail_service = nullptr;
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *								THUMBNAILSERVICE PUBLIC METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+void ThumbnailService::init() {
+	if(thumbnail_service == nullptr) thumbnail_service = new ThumbnailService;
+}
+
+
+/**
+ * Waits for thumbnails being generated, thumbnails still queued are dropped, they're requested
+ * again next time they're needed.
+ */
+void ThumbnailService::destroy() {
+	if(thumbnail_service != nullptr) {
+		delete thumbnail_service;
+		thumbnail_service = nullptr;
+	}
+}
+
+
+/**
+ * Returns smallest size thumbnails are stored at that's at least size, so they only ever have to be
+ * scaled down to be shown at size. Sizes above MAX_ICON_SIZE get COVER_SIZE.
+ */
+int ThumbnailService::getStoredSize(const int size) {
+	if(size > MAX_ICON_SIZE) return COVER_SIZE;
+
+	int stored_size = MIN_ICON_SIZE;
+	while(stored_size < size) stored_size *= 2;
+	return stored_size;
+}
+
+
+/**
+ * Returns true if every size of thumbnail of cover with cover_hash has been generated.
+ */
+bool ThumbnailService::hasThumb(const QByteArray &cover_hash) const {
+	for(int size = MIN_ICON_SIZE; size <= MAX_ICON_SIZE; size *= 2) {
+		if(!store->contains(cover_hash, size)) return false;
+	}
+
+	return store->contains(cover_hash, COVER_SIZE);
+}
+
+
+/**
+ * Returns thumbnail of cover with cover_hash at the stored size nearest to size (see
+ * getStoredSize()), or a null QImage if it hasn't been generated. See ThumbStore::get() for how
+ * long it's valid.
+ */
+QImage ThumbnailService::getThumb(const QByteArray &cover_hash, const int size) const {
+	return store->get(cover_hash, getStoredSize(size));
+}
+
+
+/**
+ * Returns composite icon stored with icon_hash at size, or a null QImage if it isn't stored. Like
+ * getThumb() it points into the store, so it should be converted or copied rather than kept.
+ */
+QImage ThumbnailService::getIcon(const QByteArray &icon_hash, const int size) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		used_icons.insert(icon_hash);
+	}
+
+	return store->get(icon_hash, size);
+}
+
+
+/**
+ * Stores composite icon with icon_hash at size, icon_hash is a hex md5 hash, like cover hashes.
+ *
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if icon fails to be stored.
+ */
+void ThumbnailService::putIcon(const QByteArray &icon_hash, const int size, const QImage &icon) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		used_icons.insert(icon_hash);
+	}
+
+	store->put(icon_hash, size, icon, getFormat(size));
+}
+
+
+/**
+ * Drops thumbnails of covers that aren't in live_cover_hashes, and icons that weren't used since
+ * service started, see ThumbStore::compact().
+ *
+ * Possible Exceptions:
+ * - FILE_ERROR may be thrown if store fails to be rewritten.
+ */
+void ThumbnailService::compact(const QSet<QByteArray> &live_cover_hashes) {
+	QSet<QByteArray> live_hashes = live_cover_hashes;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		live_hashes.unite(used_icons);
+	}
+
+	store->compact(live_hashes);
+}
+
+
+/**
+ * Queues thumbnail of comic to be generated, if it's already queued then it's priority is raised
+ * (never lowered). Any cover hash generated for comic earlier is dropped, since the comic's cover
+ * may have changed since then. Returns immediately, thread safe.
+ */
+void ThumbnailService::request(const ComicFile &comic, const Priority priority) {
+	const QByteArray md5_hash = comic.getMd5Hash();
+	const int cover_index = comic.info.getPageList().getFrontCover();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(failed_jobs.contains(md5_hash)) return;
+
+		// Cover being generated is left to finish, a different one is generated again after it
+		const bool running = running_jobs.contains(md5_hash);
+		if(running && running_jobs.value(md5_hash) == cover_index) {
+			delete rerun_jobs.take(md5_hash);
+			return;
+		}
+
+		cover_hashes.remove(md5_hash);
+		QHash<QByteArray, Job *> &jobs = running ? rerun_jobs : pending_jobs;
+
+		Job *job = jobs.value(md5_hash);
+		if(job == nullptr) {
+			job = new Job{comic.getPageSource(), cover_index, QueueKey(-priority, num_of_requests++)};
+			jobs.insert(md5_hash, job);
+		} else {
+			if(!running) queue.remove(job->key);
+			job->source			=	comic.getPageSource();
+			job->cover_index	=	cover_index;
+			job->key.first		=	qMin(job->key.first, -priority);
+		}
+
+		// Reruns are queued once the running job finishes
+		if(!running) queue.insert(job->key, md5_hash);
+	}
+
+	condition.notify_one();
+}
+
+
+/**
+ * Returns cover hash of thumbnail generated for comic with md5_hash that Library hasn't taken yet,
+ * or an empty QByteArray. Thread safe.
+ */
+QByteArray ThumbnailService::getCoverHash(const QByteArray &md5_hash) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return cover_hashes.value(md5_hash);
+}
+
+
+/**
+ * Returns cover hashes of every thumbnail generated since last called, by md5 hash of comic.
+ */
+QHash<QByteArray, QByteArray> ThumbnailService::takeCoverHashes() {
+	std::lock_guard<std::mutex> lock(mutex);
+	QHash<QByteArray, QByteArray> taken;
+	taken.swap(cover_hashes);
+	return taken;
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *								THUMBNAILSERVICE PRIVATE METHODS 								 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/**
+ * Starts one worker per core, covers are mostly decoding and scaling, so they're cpu bound.
+ */
+ThumbnailService::ThumbnailService() {
+	store = new ThumbStore(config->getThumbPath() + "/thumbs.dat");
+
+	int num_of_cores = qMax(1, QThread::idealThreadCount());
+	for(int i = 0; i < num_of_cores; i++) {
+		thread_list.push_back(std::thread(&ThumbnailService::run, this));
+	}
+}
+
+
+ThumbnailService::~ThumbnailService() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_all();
+	for(std::thread &thread : thread_list) thread.join();
+
+	qDeleteAll(pending_jobs);
+	qDeleteAll(rerun_jobs);
+	delete store;
+}
+
+
+/**
+ * Body of worker threads, generates the highest priority thumbnail, one at a time.
+ */
+void ThumbnailService::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true) {
+		if(stopping) break;
+		if(queue.isEmpty()) {
+			condition.wait(lock);
+			continue;
+		}
+
+		QByteArray md5_hash = queue.take(queue.firstKey());
+		Job *job = pending_jobs.take(md5_hash);
+		running_jobs.insert(md5_hash, job->cover_index);
+		lock.unlock();
+
+		QByteArray cover_hash;
+		try {
+			cover_hash = generate(*job);
+		} catch(const eComics::Exception &e) { e.printMsg(); }
+
+		delete job;
+
+		lock.lock();
+		running_jobs.remove(md5_hash);
+
+		// Cover changed while it was generated, what was generated is already out of date
+		job = rerun_jobs.take(md5_hash);
+		if(job != nullptr) {
+			pending_jobs.insert(md5_hash, job);
+			queue.insert(job->key, md5_hash);
+			continue;
+		}
+
+		if(cover_hash.isEmpty()) {
+			failed_jobs.insert(md5_hash);
+			continue;
+		}
+
+		cover_hashes.insert(md5_hash, cover_hash);
+		lock.unlock();
+
+		emit thumbReady(md5_hash);
+		lock.lock();
+	}
+}
+
+
+/**
+ * Reads cover of job's comic and returns it's md5 hash, the thumbnails are only scaled and stored
+ * if no comic with the same cover has them yet. Two comics with the same cover may race to store
+ * them, the later one just replaces the earlier.
+ *
+ * Possible Exceptions:
+ * - Any exception thrown by ComicFile::PageSource::readPage().
+ * - FILE_ERROR may be thrown if cover can't be decoded, or if thumbnails fail to be stored.
+ */
+QByteArray ThumbnailService::generate(const Job &job) const {
+	QByteArray cover = job.source.readPage(job.cover_index);
+	QByteArray cover_hash = QCryptographicHash::hash(cover, QCryptographicHash::Md5).toHex();
+	if(hasThumb(cover_hash)) return cover_hash;
+
+	QImage image = ComicFile::decodeImage(cover, COVER_SIZE);
+	if(image.isNull()) {
+		throw eComics::Exception(eComics::FILE_ERROR, "ThumbnailService::generate()",
+				QString("Failed to decode cover of ") + job.source.path);
+	}
+
+	// Each size is halved from the one above, rather than scaled from full size again
+	store->put(cover_hash, COVER_SIZE, image, getFormat(COVER_SIZE));
+
+	for(int size = MAX_ICON_SIZE; size >= MIN_ICON_SIZE; size /= 2) {
+		image = ImageScaler::scaled(image, size, size);
+		store->put(cover_hash, size, image, getFormat(size));
+	}
+
+	return cover_hash;
+}
+
+
+/**
+ * Returns format thumbnails are stored in at size. Raw is 4 bytes a pixel, a 256px cover alone is
+ * ~170 KiB, against ~15 KiB as jpeg, so only sizes up to MAX_RAW_SIZE are kept raw. Decoding the
+ * rest is only paid at the largest zooms.
+ */
+ThumbStore::Format ThumbnailService::getFormat(const int size) {
+	return (size <= MAX_RAW_SIZE) ? ThumbStore::RAW_FORMAT : ThumbStore::JPEG_FORMAT;
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * ThumbnailService.hpp                                                        *
+ *                                                                             *
+ * Copyright 2014 Tory Gaurnier <tory.gaurnier@linuxmail.org>                  *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published by *
+ * the Free Software Foundation; version 3.                                    *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.       *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef THUMBNAILSERVICE_HPP
+#define THUMBNAILSERVICE_HPP
+
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+
+#include "ComicFile.hpp"
+#include "ThumbStore.hpp"
+
+
+/**
+ * class ThumbnailService
+ *
+ * Generates thumbnails in the background, so that loading and importing comics never wait on
+ * extracting and scaling covers. Requests are kept in a priority queue and handled by a pool of
+ * worker threads, covers that are visible in LibraryView are requested with HIGH_PRIORITY so they
+ * jump ahead of the LOW_PRIORITY backfill of the rest of the library.
+ *
+ * Requests are deduplicated by comic, requesting a thumbnail that's already queued only raises
+ * it's priority, and one that's being generated is just left to finish, unless the comic's cover
+ * was changed since, then it's queued again once it finishes. Jobs only keep what's needed to read
+ * the cover, never the comic itself, which belongs to the GUI thread.
+ *
+ * Thumbnails are content addressed, they're kept in ThumbStore by the md5 hash of the cover image
+ * and their size. Comics with identical covers share a thumbnail, editing tags never touches it,
+ * and a changed cover gets a new one. Each cover is stored at every size from MIN_ICON_SIZE to
+ * MAX_ICON_SIZE, doubling each time, and at COVER_SIZE, for showing a single comic. All sizes are
+ * scaled from one decode. Sizes up to MAX_RAW_SIZE are stored undecoded, so LibraryView can show
+ * them right away, larger ones are jpeg, raw they'd take most of the store.
+ *
+ * Composite icons built from several covers (LibraryView's group icons) can be kept in the same
+ * store with putIcon(), keyed by a hash of the covers in them. They survive compact() as long as
+ * they were used since the service started.
+ *
+ * The cover hash of every generated thumbnail is kept until Library takes it with
+ * takeCoverHashes(), thumbReady() is emitted (from a worker thread) once it's available.
+ */
+class ThumbnailService : public QObject {
+	Q_OBJECT
+
+	public:
+		enum Priority {
+			LOW_PRIORITY, // Backfill of comics that aren't shown
+			NORMAL_PRIORITY, // Shown, but may not be on screen
+			HIGH_PRIORITY // On screen right now
+		};
+
+		// Largest side of thumbnails, in pixels, icon sizes are MIN_ICON_SIZE doubled up to MAX
+		static const int MIN_ICON_SIZE	=	64;
+		static const int MAX_ICON_SIZE	=	256;
+		static const int COVER_SIZE		=	512;
+
+		static void init();
+		static void destroy();
+		static int getStoredSize(const int size);
+		bool hasThumb(const QByteArray &cover_hash) const;
+		QImage getThumb(const QByteArray &cover_hash, const int size) const;
+		QImage getIcon(const QByteArray &icon_hash, const int size);
+		void putIcon(const QByteArray &icon_hash, const int size, const QImage &icon);
+		void compact(const QSet<QByteArray> &live_cover_hashes);
+		void request(const ComicFile &comic, const Priority priority);
+		QByteArray getCoverHash(const QByteArray &md5_hash) const;
+		QHash<QByteArray, QByteArray> takeCoverHashes();
+
+	signals:
+		void thumbReady(const QByteArray &md5_hash);
+
+	private:
+		// Queue is ordered by highest priority first, then by order of request
+		typedef QPair<int, quint64> QueueKey;
+
+		static const int MAX_RAW_SIZE = 128; // Largest size stored undecoded, see getFormat()
+
+		struct Job {
+			ComicFile::PageSource source;
+			int cover_index; // Image index of comic's front cover
+			QueueKey key;
+		};
+
+		QHash<QByteArray, Job *> pending_jobs; // By md5 hash of comic
+		QMap<QueueKey, QByteArray> queue; // Md5 hashes of pending_jobs
+		QHash<QByteArray, int> running_jobs; // Cover index being generated, by md5 hash of comic
+		QHash<QByteArray, Job *> rerun_jobs; // Requested with another cover while running
+		QSet<QByteArray> failed_jobs; // Not retried until next run, so repaints don't retry forever
+		QHash<QByteArray, QByteArray> cover_hashes; // Generated cover hashes by md5 hash of comic
+		QSet<QByteArray> used_icons; // Hashes of icons gotten or put, kept by compact()
+		quint64 num_of_requests = 0;
+		ThumbStore *store;
+		std::vector<std::thread> thread_list;
+		mutable std::mutex mutex;
+		std::condition_variable condition; // Wakes workers when jobs are queued or stopping
+		bool stopping = false;
+
+		ThumbnailService();
+		~ThumbnailService();
+		void run();
+		QByteArray generate(const Job &job) const;
+		static ThumbStore::Format getFormat(const int size);
+};
+
+extern ThumbnailService *thumbnail_service;
+
+
+#endif
\ No newline at end of file
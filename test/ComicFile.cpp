@@ -0,0 +1,93 @@
+/**
+ * Tests for ComicFile, run with `make test`. Needs 7z, comics are made in a temp dir, and HOME is
+ * pointed at a temp dir so config isn't touched.
+ */
+#include <QCoreApplication>
+#include <QDebug>
+#include <QImage>
+#include <QProcess>
+#include <QTemporaryDir>
+
+#include "src/ComicFile.hpp"
+#include "src/Config.hpp"
+#include "src/MetadataWriter.hpp"
+
+
+static int num_of_failures = 0;
+
+
+static void check(const bool passed, const char *what) {
+	if(!passed) num_of_failures++;
+	qDebug().nospace() << (passed ? "PASS: " : "FAIL: ") << what;
+}
+
+
+/**
+ * Makes a one page cbz at path, returns false if 7z failed.
+ */
+static bool makeComic(const QString &dir_path, const QString &path) {
+	QImage page(64, 96, QImage::Format_RGB32);
+	page.fill(Qt::white);
+	if(!page.save(dir_path + "/01.png")) return false;
+
+	return QProcess::execute("7z", {"a", "-tzip", "-bd", path, dir_path + "/01.png"}) == 0;
+}
+
+
+static ComicFile openComic(const QString &path) {
+	return ComicFile(path, ComicFile::generateMd5Hash(path), FileStat::fromPath(path));
+}
+
+
+/**
+ * Editing a comic and reverting the edit before the write lands must leave the file as it was,
+ * rather than skipping the revert (it matches the hash of the xml in the file) and letting the
+ * queued edit land.
+ */
+static void testRevertBeforeWrite(const QString &dir_path) {
+	const QString path = dir_path + "/Revert.cbz";
+	if(!makeComic(dir_path, path)) {
+		check(false, "7z made test comic");
+		return;
+	}
+
+	// Give file the exact xml ComicFile writes for it
+	{
+		ComicFile comic = openComic(path);
+		comic.info.setTitle("Original");
+		comic.save();
+		metadata_writer->flush();
+	}
+
+	ComicFile comic = openComic(path);
+	check(comic.info.getTitle() == "Original", "title read back from file");
+
+	// Unchanged xml is skipped, otherwise the revert below would be queued regardless
+	comic.save();
+	check(metadata_writer->getNumOfPending() == 0, "saving unchanged comic queues nothing");
+
+	comic.info.setTitle("Edited");
+	comic.save();
+	comic.info.setTitle("Original");
+	comic.save();
+	metadata_writer->flush();
+
+	check(openComic(path).info.getTitle() == "Original", "edit reverted before write is undone");
+}
+
+
+int main(int argc, char **argv) {
+	QCoreApplication app(argc, argv);
+	QTemporaryDir temp_dir;
+	qputenv("HOME", temp_dir.path().toLocal8Bit());
+
+	Config::init();
+	MetadataWriter::init();
+
+	testRevertBeforeWrite(temp_dir.path());
+
+	MetadataWriter::destroy();
+	Config::destroy();
+
+	return (num_of_failures == 0) ? 0 : 1;
+}
\ No newline at end of file